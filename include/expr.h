@@ -57,6 +57,15 @@ enum access_type {
 	ACCESS_TUPLE,
 };
 
+// An array indexed by the induction variable of a loop, whose element address
+// the loop advances by a fixed step along with the variable
+struct for_stride {
+	const struct expression *array, *index;
+	size_t size;
+	int64_t step;
+	struct for_stride *next;
+};
+
 struct expression_access {
 	enum access_type type;
 	union {
@@ -65,6 +74,10 @@ struct expression_access {
 			struct expression *array;
 			struct expression *index;
 			bool bounds_checked;
+			// Loop whose guard shows the index to be in range
+			const struct expression *guard;
+			// Element address kept by the loop, if any
+			const struct for_stride *stride;
 		};
 		struct {
 			struct expression *_struct;
@@ -192,6 +205,8 @@ struct expression_compound {
 
 struct array_literal {
 	struct expression *value;
+	// Number of additional times value is repeated, e.g. by [x...]
+	size_t repeat;
 	struct array_literal *next;
 };
 
@@ -264,6 +279,10 @@ struct expression_for {
 	struct expression *cond;
 	struct expression *afterthought;
 	struct expression *body;
+	// Evaluated before the loop; if true, indexes guarded by this loop
+	// are in range
+	struct expression *guard;
+	struct for_stride *strides;
 };
 
 struct expression_free {
@@ -387,4 +406,9 @@ struct expression {
 
 uint32_t expr_hash(const struct expression *expr);
 
+// Calls visit for each direct subexpression of an expression
+void expr_children(const struct expression *expr,
+	void (*visit)(const struct expression *expr, void *user),
+	void *user);
+
 #endif
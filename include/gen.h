@@ -35,17 +35,59 @@ struct gen_slice {
 	struct qbe_value base, len, cap;
 };
 
+// A scalar part of an aggregate binding, kept in a temporary
+struct gen_part {
+	size_t offset;
+	struct gen_value value;
+};
+
 struct gen_binding {
 	const struct scope_object *object;
+	// The binding's address, or its value if it is kept in a temporary
 	struct gen_value value;
+	bool reg;
+	// Scalar parts of a small aggregate binding which is never modified
+	// after it is initialized
+	struct gen_part *parts;
+	size_t nparts;
 	struct gen_binding *next;
 };
 
 struct gen_defer {
 	const struct expression *expr;
+	// Label of the cleanup block which runs this and all earlier defers
+	// of its scope
+	struct qbe_statement label;
+	struct qbe_value block;
 	struct gen_defer *next;
 };
 
+// An exit which runs the defers of a scope, and where the scope's cleanup
+// block continues to once they have run
+struct gen_exit {
+	uint32_t id;
+	struct qbe_value dest;
+	struct gen_exit *next;
+};
+
+// An out-of-line abort path which may be shared by aborts for the same reason
+// at the same location
+struct gen_abort {
+	struct location loc;
+	enum fixed_aborts reason;
+	struct qbe_value block;
+	struct gen_abort *next;
+};
+
+// An alloc bound to a local, which is placed on the stack if the local never
+// escapes the function
+struct gen_stackalloc {
+	const struct scope_object *object;
+	const struct expression *alloc;
+	bool escapes;
+	struct gen_stackalloc *next;
+};
+
 struct gen_scope {
 	const char *label;
 	const struct scope *scope;
@@ -54,9 +96,46 @@ struct gen_scope {
 	struct qbe_value *after;
 	struct qbe_value *end;
 	struct gen_defer *defers;
+	// Newest defer at which an exit has entered the cleanup block
+	struct gen_defer *entry;
+	struct gen_exit *exits;
+	// Identifies the exit being taken for cleanup blocks of this scope and
+	// of its children, if this is the outermost scope of a function or the
+	// scope of a defer
+	struct qbe_value selector;
+	uint32_t nexits;
 	struct gen_scope *parent;
 };
 
+// A function of this unit which is small enough to be inlined
+struct gen_inline {
+	const struct declaration *decl;
+	struct gen_inline *next;
+};
+
+// A function of this unit which only calls refer to, so that it need not follow
+// the ABI for its parameters and result
+struct gen_local {
+	const struct declaration *decl;
+	// The function is passed the address to write its aggregate result to
+	// rather than returning it
+	bool placed;
+	struct gen_local *next;
+};
+
+// A loop being generated in the copy where its bounds guard holds
+struct gen_guarded {
+	const struct expression *loop;
+	struct gen_guarded *next;
+};
+
+// The address of the element a loop's induction variable indexes
+struct gen_stride {
+	const struct for_stride *stride;
+	struct qbe_value ptr;
+	struct gen_stride *next;
+};
+
 struct rt {
 	struct qbe_value abort, ensure, fixedabort, free, malloc,
 			 memcpy, memmove, memset, strcmp, unensure;
@@ -76,6 +155,17 @@ struct gen_context {
 	const struct type *functype;
 	struct gen_binding *bindings;
 	struct gen_scope *scope;
+	// Cold blocks, such as cleanup blocks and abort paths, which are
+	// appended to the current function once it is done
+	struct qbe_statements cold;
+	struct gen_abort *aborts;
+	struct gen_stackalloc *stackallocs;
+	struct gen_inline *inlines;
+	struct gen_local *locals;
+	// Where the current function writes its result, if it is placed
+	const struct gen_value *retout;
+	struct gen_guarded *guarded;
+	struct gen_stride *strides;
 };
 
 struct unit;
@@ -267,6 +267,7 @@ struct qbe_program {
 };
 
 void qbe_append_def(struct qbe_program *prog, struct qbe_def *def);
+bool qbe_data_is_zeroes(const struct qbe_data_item *data);
 
 void pushi(struct qbe_func *func, const struct qbe_value *out, enum qbe_instr instr, ...);
 void pushprei(struct qbe_func *func, const struct qbe_value *out, enum qbe_instr instr, ...);
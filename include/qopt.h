@@ -0,0 +1,17 @@
+#ifndef HAREC_QOPT_H
+#define HAREC_QOPT_H
+#include <stddef.h>
+#include <stdio.h>
+
+struct qbe_program;
+
+struct qopt_stats {
+	size_t funcs, instrs, temps, copies, loads, stores;
+};
+
+void qopt(struct qbe_program *prog);
+void qopt_stats(const struct qbe_program *prog, struct qopt_stats *stats);
+void qopt_print_stats(const struct qopt_stats *stats, const char *when,
+	FILE *out);
+
+#endif
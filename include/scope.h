@@ -16,6 +16,10 @@ enum object_type {
 enum scope_object_flags {
 	SO_THREADLOCAL = 1 << 0,
 	SO_FOR_EACH_SUBJECT = 1 << 1,
+	// The object's address is taken, so it must be kept in memory
+	SO_ADDRESS_TAKEN = 1 << 2,
+	// The object is modified after it is initialized
+	SO_ASSIGNED = 1 << 3,
 };
 
 struct scope_object {
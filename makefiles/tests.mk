@@ -14,6 +14,14 @@ test_objects = \
 	src/typedef.o \
 	src/mod.o
 
+gen_test_objects = \
+	$(test_objects) \
+	src/gen.o \
+	src/genutil.o \
+	src/qbe.o \
+	src/qinstr.o \
+	src/qtype.o
+
 testmod_ha = testmod/measurement.ha testmod/testmod.ha
 $(HARECACHE)/testmod.ssa: $(testmod_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
 	@mkdir -p -- $(HARECACHE)
@@ -82,7 +90,11 @@ tests = \
 	tests/33-yield \
 	tests/34-declarations \
 	tests/35-floats \
-	tests/36-defines
+	tests/36-defines \
+	tests/37-memops \
+	tests/38-churn \
+	tests/39-ir \
+	tests/40-reach
 
 
 tests/00-literals: $(HARECACHE)/rt.o $(HARECACHE)/testmod.o $(HARECACHE)/tests_00_literals.o
@@ -484,3 +496,67 @@ $(HARECACHE)/tests_36_defines.ssa: $(tests_36_defines_ha) $(HARECACHE)/rt.td $(B
 	@mkdir -p -- $(HARECACHE)
 	@printf 'HAREC\t%s\n' '$@'
 	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -o $@ $(tests_36_defines_ha)
+
+
+tests/37-memops: $(HARECACHE)/rt.o $(HARECACHE)/tests_37_memops.o
+	@printf 'LD\t%s\t\n' '$@'
+	@$(LD) $(LDLINKFLAGS) -T $(RTSCRIPT) -o $@ $(HARECACHE)/rt.o $(HARECACHE)/tests_37_memops.o
+
+tests_37_memops_ha = tests/37-memops.ha
+$(HARECACHE)/tests_37_memops.ssa: $(tests_37_memops_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
+	@mkdir -p -- $(HARECACHE)
+	@printf 'HAREC\t%s\n' '$@'
+	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -o $@ $(tests_37_memops_ha)
+
+
+tests/38-churn: $(HARECACHE)/rt.o $(HARECACHE)/tests_38_churn.o
+	@printf 'LD\t%s\t\n' '$@'
+	@$(LD) $(LDLINKFLAGS) -T $(RTSCRIPT) -o $@ $(HARECACHE)/rt.o $(HARECACHE)/tests_38_churn.o
+
+tests_38_churn_ha = tests/38-churn.ha
+$(HARECACHE)/tests_38_churn.ssa: $(tests_38_churn_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
+	@mkdir -p -- $(HARECACHE)
+	@printf 'HAREC\t%s\n' '$@'
+	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -o $@ $(tests_38_churn_ha)
+
+
+tests/39-ir: $(HARECACHE)/rt.o $(HARECACHE)/tests_39_ir.o
+	@printf 'LD\t%s\t\n' '$@'
+	@$(LD) $(LDLINKFLAGS) -T $(RTSCRIPT) -o $@ $(HARECACHE)/rt.o $(HARECACHE)/tests_39_ir.o
+
+tests_39_ir_ha = tests/39-ir.ha
+$(HARECACHE)/tests_39_ir.ssa: $(tests_39_ir_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
+	@mkdir -p -- $(HARECACHE)
+	@printf 'HAREC\t%s\n' '$@'
+	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -O -o $@ $(tests_39_ir_ha)
+
+
+tests/40-reach: tests/40-reach.o $(gen_test_objects)
+	@printf 'CCLD\t%s\n' '$@'
+	@$(CC) $(LDFLAGS) $(LIBS) -o $@ tests/40-reach.o $(gen_test_objects)
+
+benchmarks = \
+	bench/churn \
+	bench/memops
+
+
+bench/churn: $(HARECACHE)/rt.o $(HARECACHE)/bench_churn.o
+	@printf 'LD\t%s\t\n' '$@'
+	@$(LD) $(LDLINKFLAGS) -T $(RTSCRIPT) -o $@ $(HARECACHE)/rt.o $(HARECACHE)/bench_churn.o
+
+bench_churn_ha = bench/churn.ha
+$(HARECACHE)/bench_churn.ssa: $(bench_churn_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
+	@mkdir -p -- $(HARECACHE)
+	@printf 'HAREC\t%s\n' '$@'
+	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -o $@ $(bench_churn_ha)
+
+
+bench/memops: $(HARECACHE)/rt.o $(HARECACHE)/bench_memops.o
+	@printf 'LD\t%s\t\n' '$@'
+	@$(LD) $(LDLINKFLAGS) -T $(RTSCRIPT) -o $@ $(HARECACHE)/rt.o $(HARECACHE)/bench_memops.o
+
+bench_memops_ha = bench/memops.ha
+$(HARECACHE)/bench_memops.ssa: $(bench_memops_ha) $(HARECACHE)/rt.td $(BINOUT)/harec
+	@mkdir -p -- $(HARECACHE)
+	@printf 'HAREC\t%s\n' '$@'
+	@$(TDENV) $(BINOUT)/harec $(HARECFLAGS) -o $@ $(bench_memops_ha)
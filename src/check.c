@@ -476,7 +476,7 @@ check_expr_alloc_slice(struct context *ctx,
 		uint64_t len = 0;
 		for (struct array_literal *c = expr->alloc.init->literal.array;
 				c != NULL; c = c->next) {
-			len++;
+			len += c->repeat + 1;
 		}
 		if (cap.literal.uval < len) {
 			error(ctx, aexpr->alloc.cap->loc, expr,
@@ -558,6 +558,40 @@ check_expr_alloc(struct context *ctx,
 	}
 }
 
+// Flags the object which holds the storage of an expression, if any. Storage
+// reached through a pointer or slice is not held by the object.
+static void
+flag_storage(struct context *ctx,
+	const struct expression *expr,
+	enum scope_object_flags flag)
+{
+	while (expr->type == EXPR_ACCESS
+			&& expr->access.type != ACCESS_IDENTIFIER) {
+		const struct expression *sub;
+		switch (expr->access.type) {
+		case ACCESS_INDEX:
+			sub = expr->access.array;
+			break;
+		case ACCESS_FIELD:
+			sub = expr->access._struct;
+			break;
+		case ACCESS_TUPLE:
+			sub = expr->access.tuple;
+			break;
+		default:
+			abort(); // Unreachable
+		}
+		enum type_storage storage = type_dealias(ctx, sub->result)->storage;
+		if (storage == STORAGE_POINTER || storage == STORAGE_SLICE) {
+			return;
+		}
+		expr = sub;
+	}
+	if (expr->type == EXPR_ACCESS) {
+		expr->access.object->flags |= flag;
+	}
+}
+
 static void
 check_expr_append_insert(struct context *ctx,
 	const struct ast_expression *aexpr,
@@ -611,6 +645,7 @@ check_expr_append_insert(struct context *ctx,
 		error(ctx, aexpr->append.object->loc, expr,
 			"cannot %s to subject of for-each loop", exprtype_name);
 	}
+	flag_storage(ctx, object, SO_ASSIGNED);
 	sltype = type_dereference(ctx, sltypename);
 	if (!sltype) {
 		error(ctx, aexpr->append.object->loc, expr,
@@ -769,6 +804,8 @@ check_assert(struct context *ctx,
 				error(ctx, loc, expr, "Static assertion failed");
 			}
 		}
+		// The assertion's operands share storage with the literal
+		expr->literal.object = NULL;
 	}
 }
 
@@ -899,6 +936,7 @@ check_expr_assign(struct context *ctx,
 			lower_implicit_cast(ctx, object->result, value);
 	}
 	expr->assign.object = object;
+	flag_storage(ctx, object, SO_ASSIGNED);
 }
 
 static const struct type *
@@ -1889,6 +1927,7 @@ check_expr_delete(struct context *ctx,
 	switch (dexpr->type) {
 	case EXPR_SLICE:
 		otype = dexpr->slice.object->result;
+		flag_storage(ctx, dexpr->slice.object, SO_ASSIGNED);
 		break;
 	case EXPR_ACCESS:
 		if (dexpr->access.type != ACCESS_INDEX) {
@@ -1905,6 +1944,7 @@ check_expr_delete(struct context *ctx,
 				"cannot delete to subject of for-each loop");
 		}
 		otype = dexpr->access.array->result;
+		flag_storage(ctx, array, SO_ASSIGNED);
 		break;
 	default:
 		error(ctx, aexpr->delete.expr->loc, expr,
@@ -2159,6 +2199,11 @@ check_expr_for_each(struct context *ctx,
 		}
 		// fallthrough
 	case FOR_EACH_VALUE:
+		if (expr->_for.kind == FOR_EACH_POINTER
+				&& initializer_type->storage == STORAGE_ARRAY) {
+			// The loop takes the address of each of its members
+			flag_storage(ctx, initializer, SO_ADDRESS_TAKEN);
+		}
 		initializer_type = type_dealias(ctx, type_dereference(ctx,
 			initializer_type));
 
@@ -2925,6 +2970,11 @@ check_expr_slice(struct context *ctx,
 			"Cannot slice non-array, non-slice object");
 		return;
 	}
+	if (type_dealias(ctx, expr->slice.object->result)->storage
+			== STORAGE_ARRAY) {
+		// The slice refers to the array's own storage
+		flag_storage(ctx, expr->slice.object, SO_ADDRESS_TAKEN);
+	}
 
 	const struct type *itype;
 	if (aexpr->slice.start) {
@@ -3639,6 +3689,8 @@ check_expr_unarithm(struct context *ctx,
 		}
 		expr->result = type_store_lookup_pointer(
 			ctx, aexpr->loc, operand->result, 0);
+
+		flag_storage(ctx, operand, SO_ADDRESS_TAKEN);
 		break;
 	case UN_DEREF:
 		if (type_dealias(ctx, operand->result)->storage != STORAGE_POINTER) {
@@ -3833,6 +3885,1035 @@ append_decl(struct context *ctx, struct declaration *decl)
 	ctx->decls = decls;
 }
 
+// Before codegen, constant subexpressions of a function body are folded with
+// eval_expr, bindings of constants which never change are replaced by their
+// values, and if and switch expressions on constants are reduced to the
+// branch they take.
+struct fold_constant {
+	const struct scope_object *object;
+	const struct expression *value;
+	struct fold_constant *next;
+};
+
+struct fold_state {
+	struct context *ctx;
+	struct fold_constant *constants;
+	// Whether bindings visited now may be propagated
+	bool propagate;
+};
+
+static bool
+fold_scalar(struct context *ctx, const struct type *type)
+{
+	type = type_dealias(ctx, type);
+	switch (type->storage) {
+	case STORAGE_BOOL:
+	case STORAGE_F32:
+	case STORAGE_F64:
+	case STORAGE_RUNE:
+		return true;
+	case STORAGE_FCONST:
+	case STORAGE_ICONST:
+	case STORAGE_RCONST:
+		return false;
+	default:
+		return type_is_integer(ctx, type);
+	}
+}
+
+static bool
+fold_literal(struct context *ctx, const struct expression *expr)
+{
+	return expr->type == EXPR_LITERAL && expr->literal.object == NULL
+		&& fold_scalar(ctx, expr->result);
+}
+
+static void
+fold_replace(struct expression *expr, const struct expression *with)
+{
+	struct location loc = expr->loc;
+	*expr = *with;
+	expr->loc = loc;
+}
+
+// Whether eval_expr computes a binary operation on these literals as the
+// generated code would, without diagnosing it
+static bool
+fold_binarithm(struct context *ctx, const struct expression *expr)
+{
+	const struct expression *lvalue = expr->binarithm.lvalue;
+	const struct expression *rvalue = expr->binarithm.rvalue;
+	bool sign = type_is_signed(ctx, lvalue->result);
+	switch (expr->binarithm.op) {
+	case BIN_LSHIFT:
+	case BIN_RSHIFT:
+		return !sign && rvalue->literal.uval < lvalue->result->size * 8;
+	case BIN_DIV:
+	case BIN_MODULO:
+		if (type_is_float(ctx, lvalue->result)) {
+			return true;
+		}
+		return rvalue->literal.uval != 0
+			&& !(sign && rvalue->literal.ival == -1);
+	default:
+		return true;
+	}
+}
+
+static void
+fold_switch(struct context *ctx, struct expression *expr)
+{
+	const struct expression *value = expr->_switch.value;
+	const struct type *type = type_dealias(ctx, value->result);
+	const struct switch_case *match = NULL;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case && !match; _case = _case->next) {
+		if (!_case->options) {
+			continue;
+		}
+		for (const struct case_option *opt = _case->options;
+				opt; opt = opt->next) {
+			const struct expression_literal *lit = &opt->value->literal;
+			bool equal;
+			if (type->storage == STORAGE_BOOL) {
+				equal = lit->bval == value->literal.bval;
+			} else if (type->storage == STORAGE_RUNE) {
+				equal = lit->rune == value->literal.rune;
+			} else {
+				equal = lit->uval == value->literal.uval;
+			}
+			if (equal) {
+				match = _case;
+				break;
+			}
+		}
+	}
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case && !match; _case = _case->next) {
+		if (!_case->options) {
+			match = _case;
+		}
+	}
+	if (match) {
+		fold_replace(expr, match->value);
+	}
+}
+
+static void
+fold_expr(struct fold_state *state, struct expression *expr)
+{
+	struct context *ctx = state->ctx;
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		if (expr->access.type != ACCESS_IDENTIFIER) {
+			return;
+		}
+		for (const struct fold_constant *c = state->constants;
+				c; c = c->next) {
+			if (c->object == expr->access.object) {
+				const struct type *result = expr->result;
+				fold_replace(expr, c->value);
+				expr->result = result;
+				return;
+			}
+		}
+		return;
+	case EXPR_BINDING:
+		if (!state->propagate) {
+			return;
+		}
+		for (const struct expression_binding *binding = &expr->binding;
+				binding; binding = binding->next) {
+			const struct scope_object *obj = binding->object;
+			if (obj == NULL || obj->otype != O_BIND
+					|| (obj->flags & (SO_ADDRESS_TAKEN | SO_ASSIGNED))
+					|| !fold_literal(ctx, binding->initializer)) {
+				continue;
+			}
+			struct fold_constant *c =
+				xcalloc(1, sizeof(struct fold_constant));
+			c->object = obj;
+			c->value = binding->initializer;
+			c->next = state->constants;
+			state->constants = c;
+		}
+		return;
+	case EXPR_BINARITHM:;
+		const struct expression *lvalue = expr->binarithm.lvalue;
+		const struct expression *rvalue = expr->binarithm.rvalue;
+		if ((expr->binarithm.op == BIN_LAND
+					|| expr->binarithm.op == BIN_LOR)
+				&& fold_literal(ctx, lvalue)) {
+			// The right operand is evaluated only if it decides
+			// the result
+			const struct type *result = expr->result;
+			bool decides = lvalue->literal.bval
+				== (expr->binarithm.op == BIN_LAND);
+			fold_replace(expr, decides ? rvalue : lvalue);
+			expr->result = result;
+			return;
+		}
+		if (!fold_literal(ctx, lvalue) || !fold_literal(ctx, rvalue)
+				|| !fold_scalar(ctx, expr->result)
+				|| !fold_binarithm(ctx, expr)) {
+			return;
+		}
+		break;
+	case EXPR_CAST:
+		if (expr->cast.kind != C_CAST
+				|| !fold_literal(ctx, expr->cast.value)
+				|| !fold_scalar(ctx, expr->result)) {
+			return;
+		}
+		break;
+	case EXPR_UNARITHM:
+		if (expr->unarithm.op == UN_ADDRESS
+				|| expr->unarithm.op == UN_DEREF
+				|| !fold_literal(ctx, expr->unarithm.operand)
+				|| !fold_scalar(ctx, expr->result)) {
+			return;
+		}
+		break;
+	case EXPR_IF:
+		if (!fold_literal(ctx, expr->_if.cond)) {
+			return;
+		}
+		if (expr->_if.cond->literal.bval) {
+			fold_replace(expr, expr->_if.true_branch);
+		} else if (expr->_if.false_branch) {
+			fold_replace(expr, expr->_if.false_branch);
+		} else if (type_dealias(ctx, expr->result)->storage
+				== STORAGE_VOID) {
+			struct location loc = expr->loc;
+			*expr = (struct expression){
+				.type = EXPR_LITERAL,
+				.result = &builtin_type_void,
+				.loc = loc,
+			};
+		}
+		return;
+	case EXPR_SWITCH:
+		if (fold_literal(ctx, expr->_switch.value)) {
+			fold_switch(ctx, expr);
+		}
+		return;
+	default:
+		return;
+	}
+
+	struct expression value = {0};
+	if (eval_expr(ctx, expr, &value)) {
+		fold_replace(expr, &value);
+	}
+}
+
+// A literal holds a 64-bit value whatever its type, which is truncated to the
+// type, and an f32 rounded to single precision, before anything is folded
+// from it, as it would be at run time
+static void
+fold_normalize(struct context *ctx, struct expression *expr)
+{
+	if (expr->type != EXPR_LITERAL || expr->literal.object != NULL) {
+		return;
+	}
+	const struct type *type = type_dealias(ctx, expr->result);
+	if (type->storage == STORAGE_F32) {
+		expr->literal.fval = (float)expr->literal.fval;
+		return;
+	}
+	if (!fold_scalar(ctx, type) || !type_is_integer(ctx, type)
+			|| type->size == SIZE_UNDEFINED || type->size >= 8) {
+		return;
+	}
+	size_t bits = type->size * 8;
+	uint64_t mask = ((uint64_t)1 << bits) - 1;
+	uint64_t val = expr->literal.uval & mask;
+	if (type_is_signed(ctx, type) && (val >> (bits - 1)) != 0) {
+		val |= ~mask;
+	}
+	expr->literal.uval = val;
+}
+
+static void
+fold_visit(const struct expression *expr, void *user)
+{
+	struct fold_state *state = user;
+	// The checked tree belongs to the checker, but expr_children walks it
+	// through const pointers
+	struct expression *_expr = (struct expression *)expr;
+	if (expr->type == EXPR_FOR) {
+		// The bindings of for-each loops are not their initializers
+		bool propagate = state->propagate;
+		state->propagate = expr->_for.kind == FOR_ACCUMULATOR;
+		if (expr->_for.bindings) {
+			fold_visit(expr->_for.bindings, state);
+		}
+		state->propagate = propagate;
+		if (expr->_for.cond) {
+			fold_visit(expr->_for.cond, state);
+		}
+		if (expr->_for.afterthought) {
+			fold_visit(expr->_for.afterthought, state);
+		}
+		fold_visit(expr->_for.body, state);
+		return;
+	}
+	expr_children(expr, fold_visit, user);
+	fold_expr(state, _expr);
+	fold_normalize(state->ctx, _expr);
+}
+
+static void
+fold_constants(struct context *ctx, struct expression *body)
+{
+	struct fold_state state = {
+		.ctx = ctx,
+		.propagate = true,
+	};
+	fold_visit(body, &state);
+	while (state.constants) {
+		struct fold_constant *next = state.constants->next;
+		free(state.constants);
+		state.constants = next;
+	}
+}
+
+// Indexes which are provably in range are marked bounds_checked once the
+// function is checked, and gen omits their bounds checks. Accumulator loops
+// whose limit is known, but not proven against the indexed object, get a guard
+// instead, which gen tests once to select a copy of the loop without the
+// checks. Loop bodies larger than this are not copied.
+#define BOUNDS_VERSION_MAX 64
+
+struct bounds_object {
+	const struct scope_object *object;
+	// For guarded arrays of known length
+	size_t length;
+	struct bounds_object *next;
+};
+
+struct bounds_loop {
+	struct expression *loop;
+	const struct scope_object *index;
+	const struct expression *limit;
+	// Head of bounds_state.locals when the loop was entered
+	const struct bounds_object *locals;
+	struct bounds_object *guarded;
+	bool versionable;
+	struct bounds_loop *next;
+};
+
+struct bounds_pair {
+	const struct scope_object *array, *index;
+	struct bounds_pair *next;
+};
+
+struct bounds_state {
+	struct context *ctx;
+	struct bounds_loop *loops;
+	// Every object bound so far, most recent first
+	struct bounds_object *locals;
+};
+
+static void
+bounds_mark(const struct expression *expr, const struct expression *guard)
+{
+	// The checked tree belongs to the checker, but expr_children walks it
+	// through const pointers
+	struct expression *access = (struct expression *)expr;
+	if (guard) {
+		access->access.guard = guard;
+	} else {
+		access->access.bounds_checked = true;
+	}
+}
+
+// Whether an expression names a binding which keeps its value throughout the
+// function
+static bool
+bounds_stable(const struct expression *expr)
+{
+	if (expr->type != EXPR_ACCESS
+			|| expr->access.type != ACCESS_IDENTIFIER) {
+		return false;
+	}
+	const struct scope_object *obj = expr->access.object;
+	return obj->otype == O_BIND
+		&& !(obj->flags & (SO_ADDRESS_TAKEN | SO_ASSIGNED))
+		&& type_dealias(NULL, obj->type)->storage != STORAGE_POINTER;
+}
+
+// Whether a loop limit keeps its value throughout the loop and may be evaluated
+// again without effect, so that a guard may test it before the loop
+static bool
+bounds_fixed(const struct expression *expr)
+{
+	if (expr->type == EXPR_CAST && expr->cast.kind == C_CAST
+			&& type_is_integer(NULL,
+				type_dealias(NULL, expr->cast.value->result))) {
+		expr = expr->cast.value;
+	}
+	switch (expr->type) {
+	case EXPR_LITERAL:
+		return expr->literal.object == NULL;
+	case EXPR_LEN:
+		return bounds_stable(expr->len.value);
+	default:
+		return bounds_stable(expr);
+	}
+}
+
+// Returns the binding an index is read from, if its address is not taken
+static const struct scope_object *
+bounds_index_object(const struct expression *expr)
+{
+	if (expr->type == EXPR_CAST && expr->cast.kind == C_CAST
+			&& type_is_integer(NULL,
+				type_dealias(NULL, expr->cast.value->result))) {
+		expr = expr->cast.value;
+	}
+	if (expr->type != EXPR_ACCESS
+			|| expr->access.type != ACCESS_IDENTIFIER) {
+		return NULL;
+	}
+	const struct scope_object *obj = expr->access.object;
+	if (obj->otype != O_BIND || (obj->flags & SO_ADDRESS_TAKEN)) {
+		return NULL;
+	}
+	return obj;
+}
+
+// Finds the largest value of an integer expression, if it is known not to be
+// negative
+static bool
+bounds_max(struct context *ctx, const struct expression *expr, uint64_t *max)
+{
+	const struct type *type = type_dealias(ctx, expr->result);
+	if (!type_is_integer(ctx, type) || type->size == SIZE_UNDEFINED) {
+		return false;
+	}
+	bool sign = type_is_signed(ctx, type);
+	size_t bits = type->size * 8 - (sign ? 1 : 0);
+	*max = bits >= 64 ? UINT64_MAX : ((uint64_t)1 << bits) - 1;
+	bool known = !sign;
+
+	uint64_t sub;
+	switch (expr->type) {
+	case EXPR_LITERAL:
+		if (expr->literal.object || (sign && expr->literal.ival < 0)) {
+			return known;
+		}
+		*max = expr->literal.uval;
+		return true;
+	case EXPR_CAST:
+		if (expr->cast.kind == C_CAST
+				&& bounds_max(ctx, expr->cast.value, &sub)
+				&& sub <= *max) {
+			*max = sub;
+			return true;
+		}
+		return known;
+	case EXPR_BINARITHM:
+		switch (expr->binarithm.op) {
+		case BIN_BAND:
+			// Either nonnegative operand bounds the result
+			if (bounds_max(ctx, expr->binarithm.lvalue, &sub)
+					&& (!known || sub < *max)) {
+				*max = sub;
+				known = true;
+			}
+			if (bounds_max(ctx, expr->binarithm.rvalue, &sub)
+					&& (!known || sub < *max)) {
+				*max = sub;
+				known = true;
+			}
+			return known;
+		case BIN_MODULO:
+			if (!sign && bounds_max(ctx, expr->binarithm.rvalue, &sub)
+					&& sub != 0 && sub - 1 < *max) {
+				*max = sub - 1;
+			}
+			return known;
+		default:
+			return known;
+		}
+	default:
+		return known;
+	}
+}
+
+// Whether an object is bound within a loop, so that its guard cannot use it
+static bool
+bounds_is_local(const struct bounds_state *state,
+	const struct bounds_loop *loop,
+	const struct scope_object *obj)
+{
+	for (const struct bounds_object *local = state->locals;
+			local != loop->locals; local = local->next) {
+		if (local->object == obj) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Guards a loop with limit <= len(array)
+static bool
+bounds_guard(struct bounds_state *state,
+	struct bounds_loop *loop,
+	const struct expression *array,
+	const struct type *atype)
+{
+	const struct expression *limit = loop->limit;
+	const struct expression *lobj = limit;
+	if (lobj->type == EXPR_CAST) {
+		lobj = lobj->cast.value;
+	}
+	if (lobj->type == EXPR_LEN) {
+		lobj = lobj->len.value;
+	}
+	if (lobj->type == EXPR_ACCESS
+			&& bounds_is_local(state, loop, lobj->access.object)) {
+		return false;
+	}
+
+	const struct scope_object *object = NULL;
+	size_t length = 0;
+	if (atype->storage == STORAGE_SLICE) {
+		if (!bounds_stable(array) || bounds_is_local(state,
+				loop, array->access.object)) {
+			return false;
+		}
+		object = array->access.object;
+	} else {
+		length = atype->array.length;
+	}
+	for (const struct bounds_object *guarded = loop->guarded;
+			guarded; guarded = guarded->next) {
+		if (guarded->object == object && guarded->length == length) {
+			return true;
+		}
+	}
+	struct bounds_object *guarded = xcalloc(1, sizeof(struct bounds_object));
+	guarded->object = object;
+	guarded->length = length;
+	guarded->next = loop->guarded;
+	loop->guarded = guarded;
+
+	struct expression *len = xcalloc(1, sizeof(struct expression));
+	len->loc = loop->loop->loc;
+	len->result = &builtin_type_size;
+	if (object) {
+		len->type = EXPR_LEN;
+		len->len.value = (struct expression *)array;
+	} else {
+		len->type = EXPR_LITERAL;
+		len->literal.uval = length;
+	}
+
+	struct expression *guard = xcalloc(1, sizeof(struct expression));
+	guard->type = EXPR_BINARITHM;
+	guard->loc = loop->loop->loc;
+	guard->result = &builtin_type_bool;
+	guard->binarithm.op = BIN_LESSEQ;
+	guard->binarithm.lvalue = lower_implicit_cast(state->ctx,
+		&builtin_type_size, (struct expression *)limit);
+	guard->binarithm.rvalue = len;
+
+	struct expression_for *_for = &loop->loop->_for;
+	if (_for->guard) {
+		struct expression *both = xcalloc(1, sizeof(struct expression));
+		both->type = EXPR_BINARITHM;
+		both->loc = loop->loop->loc;
+		both->result = &builtin_type_bool;
+		both->binarithm.op = BIN_LAND;
+		both->binarithm.lvalue = _for->guard;
+		both->binarithm.rvalue = guard;
+		guard = both;
+	}
+	_for->guard = guard;
+	return true;
+}
+
+static void
+bounds_index(struct bounds_state *state, const struct expression *expr)
+{
+	struct context *ctx = state->ctx;
+	const struct expression *array = expr->access.array;
+	const struct type *atype = type_dereference(ctx, array->result);
+	if (atype == NULL) {
+		return;
+	}
+	atype = type_dealias(ctx, atype);
+	bool known = atype->storage == STORAGE_ARRAY
+		&& atype->array.length != SIZE_UNDEFINED;
+	if (!known && atype->storage != STORAGE_SLICE) {
+		return;
+	}
+
+	uint64_t max;
+	if (known && bounds_max(ctx, expr->access.index, &max)
+			&& max < atype->array.length) {
+		bounds_mark(expr, NULL);
+		return;
+	}
+
+	const struct scope_object *index =
+		bounds_index_object(expr->access.index);
+	if (index == NULL) {
+		return;
+	}
+	for (struct bounds_loop *loop = state->loops; loop; loop = loop->next) {
+		if (loop->index != index) {
+			continue;
+		}
+		const struct expression *limit = loop->limit;
+		if (limit->type == EXPR_LEN && bounds_stable(array)
+				&& bounds_stable(limit->len.value)
+				&& limit->len.value->access.object
+					== array->access.object) {
+			bounds_mark(expr, NULL);
+		} else if (known && bounds_max(ctx, limit, &max)
+				&& max <= atype->array.length) {
+			bounds_mark(expr, NULL);
+		} else if (loop->versionable
+				&& bounds_guard(state, loop, array, atype)) {
+			bounds_mark(expr, loop->loop);
+		}
+		return;
+	}
+}
+
+struct bounds_assignment {
+	const struct scope_object *object;
+	bool found;
+};
+
+static void
+bounds_assigned_visit(const struct expression *expr, void *user)
+{
+	struct bounds_assignment *assign = user;
+	if (assign->found) {
+		return;
+	}
+	if (expr->type == EXPR_ASSIGN
+			&& expr->assign.object->type == EXPR_ACCESS
+			&& expr->assign.object->access.type == ACCESS_IDENTIFIER
+			&& expr->assign.object->access.object == assign->object) {
+		assign->found = true;
+		return;
+	}
+	expr_children(expr, bounds_assigned_visit, user);
+}
+
+static bool
+bounds_assigned(const struct expression *expr, const struct scope_object *obj)
+{
+	struct bounds_assignment assign = { .object = obj };
+	bounds_assigned_visit(expr, &assign);
+	return assign.found;
+}
+
+static void
+bounds_size_visit(const struct expression *expr, void *user)
+{
+	size_t *size = user;
+	if (*size > BOUNDS_VERSION_MAX) {
+		return;
+	}
+	++*size;
+	if (expr->type == EXPR_BINDING) {
+		// Static bindings are emitted only once
+		for (const struct expression_binding *binding = &expr->binding;
+				binding; binding = binding->next) {
+			if (binding->object && binding->object->otype == O_DECL) {
+				*size = SIZE_MAX;
+				return;
+			}
+		}
+	}
+	expr_children(expr, bounds_size_visit, user);
+}
+
+// Recognizes for (let i = 0z; i < limit; i += 1), where the body does not
+// change i and limit does not change at all
+static bool
+bounds_loop_init(struct context *ctx,
+	struct bounds_loop *loop,
+	const struct expression *expr)
+{
+	const struct expression_for *_for = &expr->_for;
+	if (_for->kind != FOR_ACCUMULATOR || _for->cond->type != EXPR_BINARITHM
+			|| _for->cond->binarithm.op != BIN_LESS
+			|| _for->cond->binarithm.lvalue->type != EXPR_ACCESS) {
+		return false;
+	}
+	const struct scope_object *index =
+		bounds_index_object(_for->cond->binarithm.lvalue);
+	if (index == NULL || bounds_assigned(_for->body, index)) {
+		return false;
+	}
+	if (type_is_signed(ctx, index->type)) {
+		// Only increments from a nonnegative start keep it in range
+		const struct expression_binding *binding = _for->bindings
+			? &_for->bindings->binding : NULL;
+		const struct expression *step = _for->afterthought;
+		uint64_t max;
+		if (binding == NULL || binding->object != index
+				|| !bounds_max(ctx, binding->initializer, &max)
+				|| step == NULL || step->type != EXPR_ASSIGN
+				|| step->assign.op != BIN_PLUS
+				|| step->assign.object->type != EXPR_ACCESS
+				|| step->assign.object->access.object != index
+				|| !bounds_max(ctx, step->assign.value, &max)
+				|| max > 1) {
+			return false;
+		}
+	}
+
+	const struct expression *limit = _for->cond->binarithm.rvalue;
+	if (!bounds_fixed(limit)) {
+		return false;
+	}
+
+	size_t size = 0;
+	bounds_size_visit(_for->body, &size);
+	loop->loop = (struct expression *)expr;
+	loop->index = index;
+	loop->limit = limit;
+	loop->versionable = size <= BOUNDS_VERSION_MAX;
+	return true;
+}
+
+// Collects the indexes which are evaluated whenever an expression completes
+static void
+bounds_must_visit(const struct expression *expr, void *user)
+{
+	struct bounds_pair **pairs = user;
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		if (expr->access.type != ACCESS_INDEX
+				|| !bounds_stable(expr->access.array)) {
+			break;
+		}
+		const struct scope_object *index =
+			bounds_index_object(expr->access.index);
+		if (index) {
+			struct bounds_pair *pair =
+				xcalloc(1, sizeof(struct bounds_pair));
+			pair->array = expr->access.array->access.object;
+			pair->index = index;
+			pair->next = *pairs;
+			*pairs = pair;
+		}
+		break;
+	case EXPR_BINARITHM:
+		if (expr->binarithm.op == BIN_LAND
+				|| expr->binarithm.op == BIN_LOR) {
+			bounds_must_visit(expr->binarithm.lvalue, user);
+			return;
+		}
+		break;
+	case EXPR_ASSIGN:
+	case EXPR_BINDING:
+	case EXPR_CALL:
+	case EXPR_CAST:
+	case EXPR_LEN:
+	case EXPR_UNARITHM:
+		break;
+	default:
+		return;
+	}
+	expr_children(expr, bounds_must_visit, user);
+}
+
+static void
+bounds_recheck_visit(const struct expression *expr, void *user)
+{
+	const struct bounds_pair *checked = user;
+	if (expr->type == EXPR_ACCESS && expr->access.type == ACCESS_INDEX
+			&& bounds_stable(expr->access.array)) {
+		const struct scope_object *index =
+			bounds_index_object(expr->access.index);
+		for (const struct bounds_pair *pair = checked;
+				index && pair; pair = pair->next) {
+			if (pair->array == expr->access.array->access.object
+					&& pair->index == index) {
+				bounds_mark(expr, NULL);
+				break;
+			}
+		}
+	}
+	if (expr->type != EXPR_DEFER) {
+		// Deferred expressions run after the index may have changed
+		expr_children(expr, bounds_recheck_visit, user);
+	}
+}
+
+static void bounds_visit(const struct expression *expr, void *user);
+
+// Within a compound expression, an index which was checked by an earlier
+// expression need not be checked again until the index is assigned
+static void
+bounds_compound(struct bounds_state *state, const struct expression *expr)
+{
+	struct bounds_pair *checked = NULL;
+	for (const struct expressions *item = &expr->compound.exprs;
+			item && item->expr; item = item->next) {
+		const struct expression *stmt = item->expr;
+		for (struct bounds_pair **pair = &checked; *pair;) {
+			if (bounds_assigned(stmt, (*pair)->index)) {
+				struct bounds_pair *next = (*pair)->next;
+				free(*pair);
+				*pair = next;
+			} else {
+				pair = &(*pair)->next;
+			}
+		}
+		if (checked) {
+			bounds_recheck_visit(stmt, checked);
+		}
+		bounds_visit(stmt, state);
+
+		struct bounds_pair *pairs = NULL;
+		bounds_must_visit(stmt, &pairs);
+		while (pairs) {
+			struct bounds_pair *next = pairs->next;
+			if (bounds_assigned(stmt, pairs->index)) {
+				free(pairs);
+			} else {
+				pairs->next = checked;
+				checked = pairs;
+			}
+			pairs = next;
+		}
+	}
+	while (checked) {
+		struct bounds_pair *next = checked->next;
+		free(checked);
+		checked = next;
+	}
+}
+
+static void
+bounds_bind(struct bounds_state *state, const struct scope_object *obj)
+{
+	struct bounds_object *local = xcalloc(1, sizeof(struct bounds_object));
+	local->object = obj;
+	local->next = state->locals;
+	state->locals = local;
+}
+
+static void
+bounds_visit(const struct expression *expr, void *user)
+{
+	struct bounds_state *state = user;
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		if (expr->access.type == ACCESS_INDEX) {
+			bounds_index(state, expr);
+		}
+		break;
+	case EXPR_BINDING:
+		for (const struct expression_binding *binding = &expr->binding;
+				binding; binding = binding->next) {
+			if (binding->object) {
+				bounds_bind(state, binding->object);
+			}
+			for (const struct binding_unpack *unpack = binding->unpack;
+					unpack; unpack = unpack->next) {
+				bounds_bind(state, unpack->object);
+			}
+		}
+		break;
+	case EXPR_COMPOUND:
+		bounds_compound(state, expr);
+		return;
+	case EXPR_FOR:;
+		struct bounds_loop loop = {0};
+		if (!bounds_loop_init(state->ctx, &loop, expr)) {
+			break;
+		}
+		const struct expression_for *_for = &expr->_for;
+		loop.locals = state->locals;
+		if (_for->bindings) {
+			bounds_visit(_for->bindings, state);
+		}
+		bounds_visit(_for->cond, state);
+		if (_for->afterthought) {
+			bounds_visit(_for->afterthought, state);
+		}
+		loop.next = state->loops;
+		state->loops = &loop;
+		bounds_visit(_for->body, state);
+		state->loops = loop.next;
+		while (loop.guarded) {
+			struct bounds_object *next = loop.guarded->next;
+			free(loop.guarded);
+			loop.guarded = next;
+		}
+		return;
+	default:
+		break;
+	}
+	expr_children(expr, bounds_visit, user);
+}
+
+static void
+elide_bounds_checks(struct context *ctx, const struct expression *body)
+{
+	struct bounds_state state = { .ctx = ctx };
+	bounds_visit(body, &state);
+	while (state.locals) {
+		struct bounds_object *next = state.locals->next;
+		free(state.locals);
+		state.locals = next;
+	}
+}
+
+struct stride_loop {
+	struct expression *loop;
+	const struct scope_object *index;
+	int64_t step;
+	struct stride_loop *next;
+};
+
+struct stride_state {
+	struct context *ctx;
+	struct stride_loop *loops;
+};
+
+// Recognizes a loop whose afterthought is i += step or i -= step, where i is a
+// word-sized integer binding which nothing else in the loop assigns
+static bool
+stride_loop_init(struct context *ctx,
+	struct stride_loop *loop,
+	const struct expression *expr)
+{
+	const struct expression_for *_for = &expr->_for;
+	const struct expression *step = _for->afterthought;
+	if (_for->kind != FOR_ACCUMULATOR || step == NULL
+			|| step->type != EXPR_ASSIGN
+			|| (step->assign.op != BIN_PLUS
+				&& step->assign.op != BIN_MINUS)
+			|| step->assign.value->type != EXPR_LITERAL
+			|| step->assign.object->type != EXPR_ACCESS) {
+		return false;
+	}
+	const struct scope_object *index =
+		bounds_index_object(step->assign.object);
+	if (index == NULL) {
+		return false;
+	}
+	const struct type *type = type_dealias(ctx, index->type);
+	if (!type_is_integer(ctx, type)
+			|| type->size != builtin_type_size.size
+			|| bounds_assigned(_for->cond, index)
+			|| bounds_assigned(_for->body, index)) {
+		return false;
+	}
+	uint64_t value = step->assign.value->literal.uval;
+	loop->loop = (struct expression *)expr;
+	loop->index = index;
+	loop->step = (int64_t)(step->assign.op == BIN_MINUS ? -value : value);
+	return true;
+}
+
+static void
+stride_index(struct stride_state *state, const struct expression *expr)
+{
+	const struct expression *array = expr->access.array;
+	const struct type *atype = type_dealias(state->ctx, array->result);
+	if ((atype->storage != STORAGE_ARRAY && atype->storage != STORAGE_SLICE)
+			|| array->type != EXPR_ACCESS
+			|| array->access.type != ACCESS_IDENTIFIER
+			|| array->access.object->otype != O_BIND) {
+		return;
+	}
+	// An array binding's elements stay where they are when it is
+	// assigned, but a slice's do not
+	if (atype->storage == STORAGE_SLICE && !bounds_stable(array)) {
+		return;
+	}
+	// The index must have the same value as the variable
+	if (expr->access.index->result->size != builtin_type_size.size) {
+		return;
+	}
+	const struct scope_object *index =
+		bounds_index_object(expr->access.index);
+	if (index == NULL) {
+		return;
+	}
+
+	for (struct stride_loop *loop = state->loops; loop; loop = loop->next) {
+		if (loop->index != index) {
+			continue;
+		}
+		struct expression_for *_for = &loop->loop->_for;
+		struct for_stride *stride = _for->strides;
+		for (; stride; stride = stride->next) {
+			if (stride->array->access.object == array->access.object
+					&& stride->size == expr->result->size) {
+				break;
+			}
+		}
+		if (stride == NULL) {
+			stride = xcalloc(1, sizeof(struct for_stride));
+			stride->array = array;
+			stride->index = expr->access.index;
+			stride->size = expr->result->size;
+			stride->step = loop->step;
+			stride->next = _for->strides;
+			_for->strides = stride;
+		}
+		((struct expression *)expr)->access.stride = stride;
+		return;
+	}
+}
+
+static void
+stride_visit(const struct expression *expr, void *user)
+{
+	struct stride_state *state = user;
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		if (expr->access.type == ACCESS_INDEX) {
+			stride_index(state, expr);
+		}
+		break;
+	case EXPR_FOR:;
+		struct stride_loop loop = {0};
+		if (!stride_loop_init(state->ctx, &loop, expr)) {
+			break;
+		}
+		// Only the body sees the variable advance with its step
+		const struct expression_for *_for = &expr->_for;
+		if (_for->bindings) {
+			stride_visit(_for->bindings, state);
+		}
+		stride_visit(_for->cond, state);
+		stride_visit(_for->afterthought, state);
+		loop.next = state->loops;
+		state->loops = &loop;
+		stride_visit(_for->body, state);
+		state->loops = loop.next;
+		return;
+	default:
+		break;
+	}
+	expr_children(expr, stride_visit, user);
+}
+
+// Finds the arrays indexed by the induction variables of loops, so that gen
+// can advance a pointer to the indexed element instead of computing its
+// address on every iteration
+static void
+reduce_strides(struct context *ctx, const struct expression *body)
+{
+	struct stride_state state = { .ctx = ctx };
+	stride_visit(body, &state);
+}
+
 static void
 resolve_unresolved(struct context *ctx)
 {
@@ -3947,6 +5028,11 @@ check_function(struct context *ctx,
 	if (body->result->storage != STORAGE_ERROR) {
 		decl->func.body = lower_implicit_cast(ctx,
 			obj->type->func.result, body);
+		if (ctx->errors == NULL) {
+			fold_constants(ctx, decl->func.body);
+			elide_bounds_checks(ctx, decl->func.body);
+			reduce_strides(ctx, decl->func.body);
+		}
 	}
 
 	scope_pop(&ctx->scope);
@@ -237,69 +237,19 @@ emit_func(const struct qbe_def *def, FILE *out)
 static void
 emit_data_string(const char *str, size_t sz, FILE *out)
 {
-	bool q = false;
+	// qbe passes string data through to the assembler verbatim, so
+	// unprintable bytes are written as octal escapes within one string
+	// rather than as a separate item per byte
+	xfprintf(out, "b \"");
 	for (size_t i = 0; i < sz; ++i) {
-		/* XXX: We could stand to emit less conservatively */
-		if (!isprint((unsigned char)(str[i])) || str[i] == '"'
-				|| str[i] == '\\') {
-			if (q) {
-				q = false;
-				xfprintf(out, "\", ");
-			}
-			xfprintf(out, "b %d%s", str[i], i + 1 < sz ? ", " : "");
+		unsigned char c = (unsigned char)str[i];
+		if (!isprint(c) || c == '"' || c == '\\') {
+			xfprintf(out, "\\%03o", c);
 		} else {
-			if (!q) {
-				q = true;
-				xfprintf(out, "b \"");
-			}
-			xfprintf(out, "%c", str[i]);
-		}
-	}
-	if (q) {
-		xfprintf(out, "\"");
-	}
-}
-
-static bool
-is_zeroes(const struct qbe_data_item *data)
-{
-	for (const struct qbe_data_item *cur = data; cur; cur = cur->next) {
-		switch (cur->type) {
-		case QD_ZEROED:
-			break;
-		case QD_VALUE:
-			switch (cur->value.kind) {
-			case QV_CONST:
-				if (cur->value.type->size < sizeof(uint64_t)) {
-					if (cur->value.wval != 0) {
-						return false;
-					}
-				} else {
-					if (cur->value.lval != 0) {
-						return false;
-					}
-				}
-				break;
-			case QV_GLOBAL:
-			case QV_LABEL:
-			case QV_TEMPORARY:
-				return false;
-			case QV_VARIADIC:
-				abort();
-			}
-			break;
-		case QD_STRING:
-			for (size_t i = 0; i < cur->sz; ++i) {
-				if (cur->str[i] != 0) {
-					return false;
-				}
-			}
-			break;
-		case QD_SYMOFFS:
-			return false;
+			xfprintf(out, "%c", c);
 		}
 	}
-	return true;
+	xfprintf(out, "\"");
 }
 
 static void
@@ -312,12 +262,12 @@ emit_data(const struct qbe_def *def, FILE *out)
 	} else if (def->data.section) {
 		xfprintf(out, "section \"%s\"", def->data.section);
 	} else if (def->data.threadlocal) {
-		if (is_zeroes(&def->data.items)) {
+		if (qbe_data_is_zeroes(&def->data.items)) {
 			xfprintf(out, "section \".tbss\" \"awT\"");
 		} else {
 			xfprintf(out, "section \".tdata\" \"awT\"");
 		}
-	} else if (is_zeroes(&def->data.items)) {
+	} else if (qbe_data_is_zeroes(&def->data.items)) {
 		xfprintf(out, "section \".bss.%s\"", def->name);
 	} else {
 		xfprintf(out, "section \".data.%s\"", def->name);
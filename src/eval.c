@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -29,13 +30,16 @@ eval_access(struct context *ctx,
 		if (!eval_expr(ctx, in->access.index, &tmp)) {
 			return false;
 		}
-		for (size_t i = tmp.literal.uval; i > 0; --i) {
-			if (array == NULL) {
-				error(ctx, in->loc, NULL,
-					"slice or array access out of bounds");
-				return false;
+		for (size_t i = tmp.literal.uval; array; array = array->next) {
+			if (i <= array->repeat) {
+				break;
 			}
-			array = array->next;
+			i -= array->repeat + 1;
+		}
+		if (array == NULL) {
+			error(ctx, in->loc, NULL,
+				"slice or array access out of bounds");
+			return false;
 		}
 		return eval_expr(ctx, array->value, out);
 	case ACCESS_FIELD:
@@ -132,6 +136,22 @@ itrunc(struct context *ctx, const struct type *type, uint64_t val)
 	assert(0);
 }
 
+// Whether a float is within the range of an integer type, so that converting it
+// is defined
+static bool
+ftoi_in_range(struct context *ctx, const struct type *type, double val)
+{
+	size_t bits = 64;
+	if (type->size != SIZE_UNDEFINED && type->size < 8) {
+		bits = type->size * 8;
+	}
+	if (type_is_signed(ctx, type)) {
+		double lim = ldexp(1.0, (int)bits - 1);
+		return val >= -lim && val < lim;
+	}
+	return val > -1.0 && val < ldexp(1.0, (int)bits);
+}
+
 static double
 ftrunc(struct context *ctx, const struct type *type, double val)
 {
@@ -416,6 +436,7 @@ eval_literal(struct context *ctx,
 			struct array_literal *alit = *anext =
 				xcalloc(1, sizeof(struct array_literal));
 			alit->value = xcalloc(1, sizeof(struct expression));
+			alit->repeat = arr->repeat;
 			if (!eval_expr(ctx, arr->value, alit->value)) {
 				return false;
 			}
@@ -509,16 +530,22 @@ eval_expand_array(struct context *ctx,
 	assert(out->type == EXPR_LITERAL);
 	assert(intype->storage == STORAGE_ARRAY);
 	assert(outtype->storage == STORAGE_ARRAY);
-	struct array_literal *array_in = in->literal.array;
+	// The last member is repeated to fill the array, which is recorded as a
+	// run rather than expanded in place
+	struct array_literal *item = NULL;
 	struct array_literal **next = &out->literal.array;
-	for (size_t i = 0; i < outtype->array.length; i++) {
-		struct array_literal *item = *next =
-			xcalloc(1, sizeof(struct array_literal));
+	size_t n = 0;
+	for (struct array_literal *array_in = in->literal.array;
+			array_in; array_in = array_in->next) {
+		item = *next = xcalloc(1, sizeof(struct array_literal));
 		item->value = array_in->value;
+		item->repeat = array_in->repeat;
 		next = &item->next;
-		if (array_in->next) {
-			array_in = array_in->next;
-		}
+		n += array_in->repeat + 1;
+	}
+	assert(item != NULL);
+	if (n < outtype->array.length) {
+		item->repeat += outtype->array.length - n;
 	}
 }
 
@@ -616,12 +643,18 @@ eval_cast(struct context *ctx,
 	case STORAGE_RCONST:
 	case STORAGE_RUNE:
 		if (type_is_float(ctx, val.result)) {
-			out->literal.ival =
-				itrunc(ctx, to, (int64_t)val.literal.fval);
-		} else if (type_is_signed(ctx, val.result)) {
-			out->literal.ival = itrunc(ctx, to, val.literal.ival);
+			double fval = val.literal.fval;
+			if (!ftoi_in_range(ctx, to, fval)) {
+				return false;
+			} else if (type_is_signed(ctx, to)) {
+				out->literal.ival = itrunc(ctx, to, (int64_t)fval);
+			} else {
+				out->literal.ival = itrunc(ctx, to, (uint64_t)fval);
+			}
 		} else {
-			out->literal.ival = itrunc(ctx, to, val.literal.uval);
+			// The value may be held wider than its own type
+			out->literal.ival = itrunc(ctx, to,
+				itrunc(ctx, from, val.literal.uval));
 		}
 		return true;
 	case STORAGE_ARRAY:
@@ -715,7 +748,7 @@ eval_len(struct context *ctx,
 	uint64_t len = 0;
 	for (struct array_literal *c = obj.literal.array;
 			c != NULL; c = c->next) {
-		len++;
+		len += c->repeat + 1;
 	}
 	out->literal.uval = len;
 	return true;
@@ -769,6 +802,10 @@ literal_default(struct context *ctx, struct expression *v)
 		v->literal.array->value->type = EXPR_LITERAL;
 		v->literal.array->value->result =
 			type_dealias(ctx, v->result)->array.members;
+		if (type_dealias(ctx, v->result)->array.length > 1) {
+			v->literal.array->repeat =
+				type_dealias(ctx, v->result)->array.length - 1;
+		}
 		return literal_default(ctx, v->literal.array->value);
 		break;
 	case STORAGE_TAGGED:
@@ -68,6 +68,7 @@ expr_hash(const struct expression *expr)
 		for (struct array_literal *al = expr->literal.array;
 				al; al = al->next) {
 			hash = fnv1a_u32(hash, expr_hash(al->value));
+			hash = fnv1a_size(hash, al->repeat);
 		}
 		break;
 	case STORAGE_STRUCT:
@@ -97,3 +98,194 @@ expr_hash(const struct expression *expr)
 	}
 	return hash;
 }
+
+static void
+literal_children(const struct expression *expr,
+	void (*visit)(const struct expression *expr, void *user),
+	void *user)
+{
+	if (expr->literal.object) {
+		return; // An address, whatever its type
+	}
+	switch (type_dealias(NULL, expr->result)->storage) {
+	case STORAGE_SLICE:
+	case STORAGE_ARRAY:
+		for (struct array_literal *al = expr->literal.array;
+				al; al = al->next) {
+			visit(al->value, user);
+		}
+		break;
+	case STORAGE_STRUCT:
+	case STORAGE_UNION:
+		for (struct struct_literal *sl = expr->literal._struct;
+				sl; sl = sl->next) {
+			visit(sl->value, user);
+		}
+		break;
+	case STORAGE_TUPLE:
+		for (struct tuple_literal *tl = expr->literal.tuple;
+				tl; tl = tl->next) {
+			visit(tl->value, user);
+		}
+		break;
+	case STORAGE_TAGGED:
+		if (expr->literal.tagged.value) {
+			visit(expr->literal.tagged.value, user);
+		}
+		break;
+	default:
+		break; // No subexpressions
+	}
+}
+
+void
+expr_children(const struct expression *expr,
+	void (*visit)(const struct expression *expr, void *user),
+	void *user)
+{
+	// Optional subexpressions are visited only if present
+#define VISIT(e) if (e) visit((e), user)
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		switch (expr->access.type) {
+		case ACCESS_IDENTIFIER:
+			break;
+		case ACCESS_INDEX:
+			VISIT(expr->access.array);
+			VISIT(expr->access.index);
+			break;
+		case ACCESS_FIELD:
+			VISIT(expr->access._struct);
+			break;
+		case ACCESS_TUPLE:
+			VISIT(expr->access.tuple);
+			break;
+		}
+		break;
+	case EXPR_ALLOC:
+		VISIT(expr->alloc.init);
+		VISIT(expr->alloc.cap);
+		break;
+	case EXPR_APPEND:
+	case EXPR_INSERT:
+		VISIT(expr->append.object);
+		VISIT(expr->append.value);
+		VISIT(expr->append.length);
+		break;
+	case EXPR_ASSERT:
+		VISIT(expr->assert.cond);
+		VISIT(expr->assert.message);
+		break;
+	case EXPR_ASSIGN:
+		VISIT(expr->assign.object);
+		VISIT(expr->assign.value);
+		break;
+	case EXPR_BINARITHM:
+		VISIT(expr->binarithm.lvalue);
+		VISIT(expr->binarithm.rvalue);
+		break;
+	case EXPR_BINDING:
+		for (const struct expression_binding *binding = &expr->binding;
+				binding; binding = binding->next) {
+			VISIT(binding->initializer);
+		}
+		break;
+	case EXPR_BREAK:
+	case EXPR_CONTINUE:
+	case EXPR_YIELD:
+		VISIT(expr->control.value);
+		break;
+	case EXPR_CALL:
+		VISIT(expr->call.lvalue);
+		for (const struct call_argument *arg = expr->call.args;
+				arg; arg = arg->next) {
+			VISIT(arg->value);
+		}
+		break;
+	case EXPR_CAST:
+		VISIT(expr->cast.value);
+		break;
+	case EXPR_COMPOUND:
+		for (const struct expressions *exprs = &expr->compound.exprs;
+				exprs; exprs = exprs->next) {
+			VISIT(exprs->expr);
+		}
+		break;
+	case EXPR_DEFER:
+		VISIT(expr->defer.deferred);
+		break;
+	case EXPR_DELETE:
+		VISIT(expr->delete.expr);
+		break;
+	case EXPR_FOR:
+		VISIT(expr->_for.bindings);
+		VISIT(expr->_for.cond);
+		VISIT(expr->_for.afterthought);
+		VISIT(expr->_for.body);
+		break;
+	case EXPR_FREE:
+		VISIT(expr->free.expr);
+		break;
+	case EXPR_IF:
+		VISIT(expr->_if.cond);
+		VISIT(expr->_if.true_branch);
+		VISIT(expr->_if.false_branch);
+		break;
+	case EXPR_LEN:
+		VISIT(expr->len.value);
+		break;
+	case EXPR_LITERAL:
+		literal_children(expr, visit, user);
+		break;
+	case EXPR_MATCH:
+		VISIT(expr->match.value);
+		for (const struct match_case *_case = expr->match.cases;
+				_case; _case = _case->next) {
+			VISIT(_case->value);
+		}
+		break;
+	case EXPR_RETURN:
+		VISIT(expr->_return.value);
+		break;
+	case EXPR_SLICE:
+		VISIT(expr->slice.object);
+		VISIT(expr->slice.start);
+		VISIT(expr->slice.end);
+		break;
+	case EXPR_STRUCT:
+		for (const struct expr_struct_field *field = expr->_struct.fields;
+				field; field = field->next) {
+			VISIT(field->value);
+		}
+		break;
+	case EXPR_SWITCH:
+		VISIT(expr->_switch.value);
+		for (const struct switch_case *_case = expr->_switch.cases;
+				_case; _case = _case->next) {
+			for (const struct case_option *opt = _case->options;
+					opt; opt = opt->next) {
+				VISIT(opt->value);
+			}
+			VISIT(_case->value);
+		}
+		break;
+	case EXPR_TUPLE:
+		for (const struct expression_tuple *item = &expr->tuple;
+				item; item = item->next) {
+			VISIT(item->value);
+		}
+		break;
+	case EXPR_UNARITHM:
+		VISIT(expr->unarithm.operand);
+		break;
+	case EXPR_VAARG:
+	case EXPR_VAEND:
+		VISIT(expr->vaarg.ap);
+		break;
+	case EXPR_DEFINE:
+	case EXPR_PROPAGATE:
+	case EXPR_VASTART:
+		break;
+	}
+#undef VISIT
+}
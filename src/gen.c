@@ -26,6 +26,7 @@ static struct gen_value gen_expr_with(struct gen_context *ctx,
 	struct gen_value *out);
 static void gen_global_decl(struct gen_context *ctx,
 	const struct declaration *decl);
+static void pop_scope(struct gen_context *ctx);
 
 static struct gen_scope *
 gen_scope_lookup(struct gen_context *ctx, const struct scope *which)
@@ -49,38 +50,278 @@ push_scope(struct gen_context *ctx, const struct scope *scope)
 	return new;
 }
 
+// Switches and matches with fewer options than this are lowered to a linear
+// chain of comparisons
+#define SWITCH_RANGES_MIN 5
+
+struct switch_range {
+	// Ordering keys of the first and last values of the range
+	uint64_t lo, hi;
+	size_t _case;
+};
+
+static int
+switch_range_compar(const void *_a, const void *_b)
+{
+	const struct switch_range *a = _a, *b = _b;
+	return a->lo < b->lo ? -1 : a->lo > b->lo ? 1 : 0;
+}
+
+// Returns the key by which a case option is ordered. Signed values are biased
+// so that their keys order the same way as the values themselves.
+static uint64_t
+switch_range_key(const struct type *type, const struct expression *value)
+{
+	assert(value->type == EXPR_LITERAL);
+	if (type_is_signed(NULL, type)) {
+		return (uint64_t)value->literal.ival ^ ((uint64_t)1 << 63);
+	}
+	uint64_t key = type->storage == STORAGE_RUNE
+		? value->literal.rune : value->literal.uval;
+	if (type->size < sizeof(uint64_t)) {
+		key &= ((uint64_t)1 << (type->size * 8)) - 1;
+	}
+	return key;
+}
+
+static struct qbe_value
+switch_range_value(const struct type *type,
+	const struct qbe_type *qtype, uint64_t key)
+{
+	if (type_is_signed(NULL, type)) {
+		key ^= (uint64_t)1 << 63;
+	}
+	return qtype->stype == Q_LONG ? constl(key) : constw((uint32_t)key);
+}
+
+// Emits a balanced binary search over the sorted ranges, branching to the
+// matching case or to bdefault if no range contains the value.
 static void
-pop_scope(struct gen_context *ctx)
+gen_switch_search(struct gen_context *ctx, const struct type *type,
+	struct qbe_value *qval, const struct switch_range *ranges, size_t n,
+	struct qbe_value *bcases, struct qbe_value *bdefault)
 {
-	struct gen_scope *scope = ctx->scope;
-	ctx->scope = scope->parent;
-	for (struct gen_defer *defer = scope->defers; defer; /* n/a */) {
-		struct gen_defer *next = defer->next;
-		free(defer);
-		defer = next;
+	const struct qbe_type *qtype = qtype_lookup(ctx, type, false);
+	struct qbe_value cond = mkqtmp(ctx, &qbe_word, ".%d");
+	if (n <= 3) {
+		enum qbe_instr eq = binarithm_for_op(ctx, BIN_LEQUAL, type);
+		enum qbe_instr le = qtype->stype == Q_LONG ? Q_CULEL : Q_CULEW;
+		for (size_t i = 0; i < n; ++i) {
+			struct qbe_statement lnext;
+			struct qbe_value bnext = mklabel(ctx, &lnext, ".%d");
+			struct qbe_value lo = switch_range_value(type, qtype,
+				ranges[i].lo);
+			if (ranges[i].lo == ranges[i].hi) {
+				pushi(ctx->current, &cond, eq, qval, &lo, NULL);
+			} else {
+				// lo <= value && value <= hi, as one unsigned
+				// comparison
+				struct qbe_value diff = mkqtmp(ctx, qtype, ".%d");
+				struct qbe_value span = switch_range_value(
+					&builtin_type_u64, qtype,
+					ranges[i].hi - ranges[i].lo);
+				pushi(ctx->current, &diff, Q_SUB, qval, &lo, NULL);
+				pushi(ctx->current, &cond, le, &diff, &span, NULL);
+			}
+			pushi(ctx->current, NULL, Q_JNZ, &cond,
+				&bcases[ranges[i]._case], &bnext, NULL);
+			push(&ctx->current->body, &lnext);
+		}
+		pushi(ctx->current, NULL, Q_JMP, bdefault, NULL);
+		return;
 	}
-	free(scope);
+
+	size_t mid = n / 2;
+	struct qbe_statement llow, lhigh;
+	struct qbe_value blow = mklabel(ctx, &llow, ".%d");
+	struct qbe_value bhigh = mklabel(ctx, &lhigh, ".%d");
+	struct qbe_value pivot = switch_range_value(type, qtype, ranges[mid].lo);
+	enum qbe_instr lt = binarithm_for_op(ctx, BIN_LESS, type);
+	pushi(ctx->current, &cond, lt, qval, &pivot, NULL);
+	pushi(ctx->current, NULL, Q_JNZ, &cond, &blow, &bhigh, NULL);
+	push(&ctx->current->body, &llow);
+	gen_switch_search(ctx, type, qval, ranges, mid, bcases, bdefault);
+	push(&ctx->current->body, &lhigh);
+	gen_switch_search(ctx, type, qval, &ranges[mid], n - mid,
+		bcases, bdefault);
+}
+
+// Returns the outermost scope whose defers are run on an abort from the
+// current scope: that of the enclosing defer, if any, or else the outermost
+// scope of the function
+static struct gen_scope *
+defer_boundary(struct gen_scope *scope)
+{
+	while (scope && scope->parent && scope->scope->class != SCOPE_DEFER
+			&& scope->scope->class != SCOPE_FUNC) {
+		scope = scope->parent;
+	}
+	return scope;
 }
 
+// Runs the defers of each scope from the current scope up to and including
+// the given scope, or up to the outermost scope if NULL.
+//
+// The defers of a scope are generated only once, in a cleanup block emitted
+// when the scope is popped, with a label ahead of each defer so that an exit
+// may enter it wherever the defers then registered begin. The exit stores its
+// ID in a selector and branches to the cleanup block of the innermost scope,
+// which dispatches on the selector to the cleanup block of the next scope
+// with defers, or back to the code following the exit.
 static void
-gen_defers(struct gen_context *ctx, struct gen_scope *scope)
+gen_defers(struct gen_context *ctx, struct gen_scope *last)
 {
-	if (!scope) {
+	struct gen_scope *first = NULL;
+	for (struct gen_scope *scope = ctx->scope;
+			scope; scope = scope->parent) {
+		if (scope->defers) {
+			first = scope;
+			break;
+		}
+		if (scope == last) {
+			break;
+		}
+	}
+	if (!first) {
 		return;
 	}
-	if (scope->defers) {
-		pushc(ctx->current, "gen defers");
+
+	struct gen_scope *level = defer_boundary(ctx->scope);
+	if (!level->selector.name) {
+		level->selector = mkqtmp(ctx, &qbe_word, "cleanup.%d");
 	}
+	uint32_t id = level->nexits++;
+
+	struct qbe_statement lcont;
+	struct qbe_value bcont = mklabel(ctx, &lcont, "cont.%d");
+	struct qbe_value qid = constw(id);
+	pushc(ctx->current, "gen defers");
+	pushi(ctx->current, &level->selector, Q_COPY, &qid, NULL);
+	pushi(ctx->current, NULL, Q_JMP, &first->defers->block, NULL);
+
+	for (struct gen_scope *scope = first, *next; scope; scope = next) {
+		next = NULL;
+		for (struct gen_scope *parent = scope->parent;
+				scope != last && parent; parent = parent->parent) {
+			if (parent->defers) {
+				next = parent;
+				break;
+			}
+			if (parent == last) {
+				break;
+			}
+		}
+
+		struct gen_exit *exit = xcalloc(1, sizeof(struct gen_exit));
+		exit->id = id;
+		exit->dest = next ? next->defers->block : bcont;
+		exit->next = scope->exits;
+		scope->exits = exit;
+		scope->entry = scope->defers;
+	}
+
+	push(&ctx->current->body, &lcont);
+}
+
+// Redirects the code generated from here on to a new block list, returning
+// the one it was being added to
+static struct qbe_statements
+begin_cold(struct gen_context *ctx)
+{
+	struct qbe_statements body = ctx->current->body;
+	ctx->current->body = (struct qbe_statements){0};
+	return body;
+}
+
+// Moves the code generated since begin_cold to the cold blocks of the current
+// function, and restores the block list it returned
+static void
+end_cold(struct gen_context *ctx, struct qbe_statements body)
+{
+	struct qbe_statements cold = ctx->current->body;
+	ctx->current->body = body;
+	for (size_t i = 0; i < cold.ln; ++i) {
+		push(&ctx->cold, &cold.stmts[i]);
+	}
+	free(cold.stmts);
+}
+
+// Emits the cleanup block of a scope which is about to be popped, if any exit
+// has entered it
+static void
+gen_cleanup(struct gen_context *ctx, struct gen_scope *scope)
+{
+	if (!scope->exits) {
+		return;
+	}
+
+	struct qbe_statements body = begin_cold(ctx);
 	struct gen_defer *defers = scope->defers;
-	while (scope->defers) {
-		struct gen_defer *defer = scope->defers;
+	for (struct gen_defer *defer = scope->entry;
+			defer; defer = defer->next) {
 		assert(defer->expr->type == EXPR_DEFER);
-		scope->defers = scope->defers->next;
+		push(&ctx->current->body, &defer->label);
+		scope->defers = defer->next;
 		push_scope(ctx, defer->expr->defer.scope);
 		gen_expr(ctx, defer->expr->defer.deferred);
 		pop_scope(ctx);
 	}
 	scope->defers = defers;
+
+	size_t nexits = 0;
+	for (struct gen_exit *exit = scope->exits; exit; exit = exit->next) {
+		++nexits;
+	}
+	struct qbe_value *dests = xcalloc(nexits, sizeof(struct qbe_value));
+	struct switch_range *ranges =
+		xcalloc(nexits, sizeof(struct switch_range));
+	size_t i = 0;
+	for (struct gen_exit *exit = scope->exits; exit; exit = exit->next, ++i) {
+		dests[i] = exit->dest;
+		ranges[i] = (struct switch_range){
+			.lo = exit->id,
+			.hi = exit->id,
+			._case = i,
+		};
+	}
+	qsort(ranges, nexits, sizeof(struct switch_range), switch_range_compar);
+	size_t n = 0;
+	for (size_t j = 0; j < nexits; ++j) {
+		if (n != 0 && ranges[n - 1].hi + 1 == ranges[j].lo
+				&& dests[ranges[n - 1]._case].name
+					== dests[ranges[j]._case].name) {
+			ranges[n - 1].hi = ranges[j].lo;
+			continue;
+		}
+		ranges[n++] = ranges[j];
+	}
+	// Every selector value is that of some exit, so the last range need
+	// not be tested
+	struct gen_scope *level = defer_boundary(scope);
+	gen_switch_search(ctx, &builtin_type_u32, &level->selector,
+		ranges, n - 1, dests, &dests[ranges[n - 1]._case]);
+	free(ranges);
+	free(dests);
+	end_cold(ctx, body);
+}
+
+static void
+pop_scope(struct gen_context *ctx)
+{
+	struct gen_scope *scope = ctx->scope;
+	gen_cleanup(ctx, scope);
+	ctx->scope = scope->parent;
+	for (struct gen_defer *defer = scope->defers; defer; /* n/a */) {
+		struct gen_defer *next = defer->next;
+		free(defer);
+		defer = next;
+	}
+	for (struct gen_exit *exit = scope->exits; exit; /* n/a */) {
+		struct gen_exit *next = exit->next;
+		free(exit);
+		exit = next;
+	}
+	free(scope);
 }
 
 static void
@@ -107,6 +348,206 @@ gen_copy_aligned(struct gen_context *ctx,
 	pushi(ctx->current, NULL, Q_BLIT, &srcv, &destv, &size, NULL);
 }
 
+static void
+gen_copy_bytes(struct gen_context *ctx,
+	struct qbe_value *dest, struct qbe_value *src, size_t size)
+{
+	struct qbe_value sz = constl(size);
+	if (size > 128) {
+		pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memcpy,
+			dest, src, &sz, NULL);
+	} else {
+		pushi(ctx->current, NULL, Q_BLIT, src, dest, &sz, NULL);
+	}
+}
+
+// Tagged unions larger than this whose members are of very uneven sizes are
+// copied by dispatching on the tag, so that only the tag and the bytes of the
+// active member are copied
+#define TAGGED_COPY_MIN 128
+
+static void
+gen_copy_tagged(struct gen_context *ctx,
+	struct gen_value dest, struct gen_value src)
+{
+	// Members needing at most a quarter of the union are small, and are
+	// all copied by copying the bytes needed by the largest of them
+	const struct type *type = type_dealias(NULL, dest.type);
+	size_t small = 0;
+	for (const struct type_tagged_union *tu = &type->tagged;
+			tu; tu = tu->next) {
+		size_t extent = compute_tagged_memb_offset(tu->type).lval
+			+ tu->type->size;
+		if (extent <= type->size / 4 && extent > small) {
+			small = extent;
+		}
+	}
+	if (type->size <= TAGGED_COPY_MIN || small == 0) {
+		gen_copy_aligned(ctx, dest, src);
+		return;
+	}
+
+	struct qbe_value qdest = mklval(ctx, &dest), qsrc = mklval(ctx, &src);
+	struct qbe_value tag = mkqtmp(ctx, &qbe_word, "tag.%d");
+	enum qbe_instr load = load_for_type(ctx, &builtin_type_u32);
+	pushi(ctx->current, &tag, load, &qsrc, NULL);
+
+	struct qbe_statement lend;
+	struct qbe_value bend = mklabel(ctx, &lend, ".%d");
+	struct qbe_value match = mkqtmp(ctx, &qbe_word, ".%d");
+	for (const struct type_tagged_union *tu = &type->tagged;
+			tu; tu = tu->next) {
+		size_t extent = compute_tagged_memb_offset(tu->type).lval
+			+ tu->type->size;
+		if (extent <= type->size / 4) {
+			continue;
+		}
+		struct qbe_statement lcopy, lnext;
+		struct qbe_value bcopy = mklabel(ctx, &lcopy, "copy.%d");
+		struct qbe_value bnext = mklabel(ctx, &lnext, ".%d");
+		struct qbe_value id = constw(tu->type->id);
+		pushi(ctx->current, &match, Q_CEQW, &tag, &id, NULL);
+		pushi(ctx->current, NULL, Q_JNZ, &match, &bcopy, &bnext, NULL);
+		push(&ctx->current->body, &lcopy);
+		gen_copy_bytes(ctx, &qdest, &qsrc, extent);
+		pushi(ctx->current, NULL, Q_JMP, &bend, NULL);
+		push(&ctx->current->body, &lnext);
+	}
+	gen_copy_bytes(ctx, &qdest, &qsrc, small);
+	push(&ctx->current->body, &lend);
+}
+
+// Zero-initializes an object of the given size and alignment, including any
+// padding. Small objects are cleared with a few of the widest stores their
+// alignment permits, and larger objects with a call to rt.memset.
+static void
+gen_zero_at(struct gen_context *ctx, struct qbe_value *base,
+	size_t size, size_t align)
+{
+	size_t width = 8;
+	while (width > 1 && (align == ALIGN_UNDEFINED || align < width)) {
+		width /= 2;
+	}
+
+	size_t nstores = 0;
+	for (size_t offs = 0, w = width; offs < size; offs += w) {
+		while (offs + w > size) {
+			w /= 2;
+		}
+		++nstores;
+	}
+	if (nstores > 8) {
+		struct qbe_value zero = constl(0), sz = constl(size);
+		pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memset,
+			base, &zero, &sz, NULL);
+		return;
+	}
+
+	struct qbe_value ptr = mkqtmp(ctx, ctx->arch.ptr, ".%d");
+	for (size_t offs = 0, w = width; offs < size; offs += w) {
+		while (offs + w > size) {
+			w /= 2;
+		}
+		enum qbe_instr store;
+		struct qbe_value zero;
+		switch (w) {
+		case 8:
+			store = Q_STOREL, zero = constl(0);
+			break;
+		case 4:
+			store = Q_STOREW, zero = constw(0);
+			break;
+		case 2:
+			store = Q_STOREH, zero = constw(0);
+			break;
+		default:
+			store = Q_STOREB, zero = constw(0);
+			break;
+		}
+		struct qbe_value qoffs = constl(offs);
+		pushi(ctx->current, &ptr, Q_ADD, base, &qoffs, NULL);
+		pushi(ctx->current, NULL, store, &zero, &ptr, NULL);
+	}
+}
+
+// Copies the array member at ptr into the count members which follow it,
+// doubling the initialized region with each copy.
+static void
+gen_fill_repeat(struct gen_context *ctx, struct qbe_value *ptr,
+	size_t msize, size_t count)
+{
+	size_t done = 1, total = count + 1;
+	while (done < total) {
+		size_t chunk = done < total - done ? done : total - done;
+		struct qbe_value offs = constl(done * msize);
+		struct qbe_value next = mkqtmp(ctx, ctx->arch.ptr, ".%d");
+		pushi(ctx->current, &next, Q_ADD, ptr, &offs, NULL);
+		struct qbe_value sz = constl(chunk * msize);
+		if (chunk * msize > 128) {
+			pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memcpy,
+				&next, ptr, &sz, NULL);
+		} else {
+			pushi(ctx->current, NULL, Q_BLIT, ptr, &next, &sz, NULL);
+		}
+		done += chunk;
+	}
+}
+
+// Returns true if the given literal is represented by all zero bits.
+static bool
+literal_is_zero(const struct expression *expr)
+{
+	if (expr->type != EXPR_LITERAL || expr->literal.object) {
+		return false;
+	}
+	const struct type *type = type_dealias(NULL, expr->result);
+	switch (type->storage) {
+	case STORAGE_ARRAY:
+	case STORAGE_SLICE:
+		if (type->storage == STORAGE_SLICE && expr->literal.array) {
+			return false;
+		}
+		for (const struct array_literal *c = expr->literal.array;
+				c; c = c->next) {
+			if (!literal_is_zero(c->value)) {
+				return false;
+			}
+		}
+		return true;
+	case STORAGE_STRUCT:
+		for (const struct struct_literal *f = expr->literal._struct;
+				f; f = f->next) {
+			if (!literal_is_zero(f->value)) {
+				return false;
+			}
+		}
+		return true;
+	case STORAGE_TUPLE:
+		for (const struct tuple_literal *t = expr->literal.tuple;
+				t; t = t->next) {
+			if (!literal_is_zero(t->value)) {
+				return false;
+			}
+		}
+		return true;
+	case STORAGE_STRING:
+		return expr->literal.string.len == 0;
+	case STORAGE_BOOL:
+		return !expr->literal.bval;
+	case STORAGE_RCONST:
+	case STORAGE_RUNE:
+		return expr->literal.rune == 0;
+	case STORAGE_TAGGED:
+	case STORAGE_UNION:
+		return false;
+	case STORAGE_VOID:
+	case STORAGE_DONE:
+		return true;
+	default:
+		return expr->literal.uval == 0;
+	}
+}
+
 static void
 gen_store(struct gen_context *ctx,
 	struct gen_value object,
@@ -119,11 +560,13 @@ gen_store(struct gen_context *ctx,
 	case STORAGE_STRING:
 	case STORAGE_STRUCT:
 	case STORAGE_UNION:
-	case STORAGE_TAGGED:
 	case STORAGE_TUPLE:
 	case STORAGE_VALIST:
 		gen_copy_aligned(ctx, object, value);
 		return;
+	case STORAGE_TAGGED:
+		gen_copy_tagged(ctx, object, value);
+		return;
 	case STORAGE_ENUM:
 		object.type = ty->alias.type;
 		break;
@@ -196,16 +639,54 @@ gen_load_tag(struct gen_context *ctx,
 	pushi(ctx->current, out, load, from, NULL);
 }
 
+// Branches to the path which runs the pending defers and aborts for the given
+// reason. Abort paths are emitted out of line, and those which have no defers
+// to run are shared by the aborts at the same location for the same reason.
 static void
 gen_fixed_abort(struct gen_context *ctx,
 	struct location loc, enum fixed_aborts reason)
 {
-	for (struct gen_scope *scope = ctx->scope; scope; scope = scope->parent) {
-		gen_defers(ctx, scope);
-		if (scope->scope->class == SCOPE_DEFER) {
+	struct gen_scope *boundary = defer_boundary(ctx->scope);
+	bool defers = false;
+	for (struct gen_scope *scope = ctx->scope;
+			scope; scope = scope->parent) {
+		if (scope->defers) {
+			defers = true;
+			break;
+		}
+		if (scope == boundary) {
 			break;
 		}
 	}
+	if (!defers) {
+		for (struct gen_abort *site = ctx->aborts;
+				site; site = site->next) {
+			if (site->reason == reason
+					&& site->loc.file == loc.file
+					&& site->loc.lineno == loc.lineno
+					&& site->loc.colno == loc.colno) {
+				pushi(ctx->current, NULL, Q_JMP,
+					&site->block, NULL);
+				return;
+			}
+		}
+	}
+
+	struct qbe_statement labort;
+	struct qbe_value babort = mklabel(ctx, &labort, "abort.%d");
+	pushi(ctx->current, NULL, Q_JMP, &babort, NULL);
+	if (!defers) {
+		struct gen_abort *site = xcalloc(1, sizeof(struct gen_abort));
+		site->loc = loc;
+		site->reason = reason;
+		site->block = babort;
+		site->next = ctx->aborts;
+		ctx->aborts = site;
+	}
+
+	struct qbe_statements body = begin_cold(ctx);
+	push(&ctx->current->body, &labort);
+	gen_defers(ctx, boundary);
 
 	struct qbe_value path = mklval(ctx, &ctx->sources[loc.file]);
 	struct qbe_value line = constl(loc.lineno);
@@ -214,6 +695,7 @@ gen_fixed_abort(struct gen_context *ctx,
 	pushi(ctx->current, NULL, Q_CALL, &ctx->rt.fixedabort,
 			&path, &line, &col, &tmp, NULL);
 	pushi(ctx->current, NULL, Q_HLT, NULL);
+	end_cold(ctx, body);
 }
 
 static struct gen_value
@@ -270,6 +752,7 @@ gen_access_ident(struct gen_context *ctx, const struct scope_object *obj)
 		for (const struct gen_binding *gb = ctx->bindings;
 				gb; gb = gb->next) {
 			if (gb->object == obj) {
+				assert(!gb->reg); // Invariant
 				return gb->value;
 			}
 		}
@@ -289,6 +772,150 @@ gen_access_ident(struct gen_context *ctx, const struct scope_object *obj)
 	abort(); // Invariant
 }
 
+static const struct gen_binding *
+gen_binding_lookup(struct gen_context *ctx, const struct expression *expr)
+{
+	if (expr->type != EXPR_ACCESS
+			|| expr->access.type != ACCESS_IDENTIFIER
+			|| expr->access.object->otype != O_BIND) {
+		return NULL;
+	}
+	for (const struct gen_binding *gb = ctx->bindings;
+			gb; gb = gb->next) {
+		if (gb->object == expr->access.object) {
+			return gb;
+		}
+	}
+	return NULL;
+}
+
+static struct gen_value
+gen_copy_temp(struct gen_context *ctx, struct gen_value value)
+{
+	struct gen_value copy = mkgtemp(ctx, value.type, ".%d");
+	struct qbe_value qcopy = mkqval(ctx, &copy),
+		qval = mkqval(ctx, &value);
+	pushi(ctx->current, &qcopy, Q_COPY, &qval, NULL);
+	return copy;
+}
+
+// Small aggregates of at most this many scalar parts are kept in temporaries
+// as well as in memory, if they are never modified after they are initialized
+#define BINDING_PARTS_MAX 4
+
+static void
+gen_binding_parts(struct gen_context *ctx, struct gen_binding *gb)
+{
+	if (gb->object->flags & (SO_ADDRESS_TAKEN | SO_ASSIGNED)) {
+		return;
+	}
+	struct gen_part parts[BINDING_PARTS_MAX];
+	size_t nparts = 0;
+	const struct type *type = type_dealias(NULL, gb->value.type);
+	switch (type->storage) {
+	case STORAGE_SLICE:
+	case STORAGE_STRING:
+		parts[0].offset = 0;
+		parts[0].value.type = &builtin_type_uintptr;
+		parts[1].offset = ctx->arch.ptr->size;
+		parts[1].value.type = &builtin_type_size;
+		parts[2].offset = ctx->arch.ptr->size + ctx->arch.sz->size;
+		parts[2].value.type = &builtin_type_size;
+		nparts = 3;
+		break;
+	case STORAGE_STRUCT:
+		for (const struct struct_field *field = type->struct_union.fields;
+				field; field = field->next) {
+			if (field->type->size == 0) {
+				continue;
+			}
+			if (nparts == BINDING_PARTS_MAX
+					|| type_is_aggregate(field->type)) {
+				return;
+			}
+			parts[nparts].offset = field->offset;
+			parts[nparts].value.type = field->type;
+			++nparts;
+		}
+		break;
+	case STORAGE_TUPLE:
+		for (const struct type_tuple *tuple = &type->tuple;
+				tuple; tuple = tuple->next) {
+			if (tuple->type->size == 0) {
+				continue;
+			}
+			if (nparts == BINDING_PARTS_MAX
+					|| type_is_aggregate(tuple->type)) {
+				return;
+			}
+			parts[nparts].offset = tuple->offset;
+			parts[nparts].value.type = tuple->type;
+			++nparts;
+		}
+		break;
+	default:
+		return;
+	}
+
+	struct qbe_value base = mklval(ctx, &gb->value);
+	gb->parts = xcalloc(nparts, sizeof(struct gen_part));
+	gb->nparts = nparts;
+	for (size_t i = 0; i < nparts; ++i) {
+		struct qbe_value offs = constl(parts[i].offset);
+		struct gen_value addr = mkgtemp(ctx,
+			parts[i].value.type, "part.%d");
+		struct qbe_value qaddr = mklval(ctx, &addr);
+		pushi(ctx->current, &qaddr, Q_ADD, &base, &offs, NULL);
+		gb->parts[i].offset = parts[i].offset;
+		gb->parts[i].value = gen_load(ctx, addr);
+	}
+}
+
+static const struct gen_part *
+gen_binding_part(struct gen_context *ctx,
+	const struct expression *expr,
+	size_t offset)
+{
+	const struct gen_binding *gb = gen_binding_lookup(ctx, expr);
+	if (!gb) {
+		return NULL;
+	}
+	for (size_t i = 0; i < gb->nparts; ++i) {
+		if (gb->parts[i].offset == offset) {
+			return &gb->parts[i];
+		}
+	}
+	return NULL;
+}
+
+// Like load_slice_data, for a slice or string binding whose parts are kept in
+// temporaries. Returns false if the expression is not such a binding.
+static bool
+gen_slice_parts(struct gen_context *ctx,
+	const struct expression *expr,
+	struct qbe_value *base,
+	struct qbe_value *len,
+	struct qbe_value *cap)
+{
+	const struct type *type = type_dealias(NULL, expr->result);
+	if (type->storage != STORAGE_SLICE && type->storage != STORAGE_STRING) {
+		return false;
+	}
+	const struct gen_binding *gb = gen_binding_lookup(ctx, expr);
+	if (!gb || gb->nparts == 0) {
+		return false;
+	}
+	struct qbe_value *out[] = { base, len, cap };
+	for (size_t i = 0; i < 3; ++i) {
+		if (out[i]) {
+			struct gen_value v = gen_copy_temp(ctx,
+				gb->parts[i].value);
+			*out[i] = mkqval(ctx, &v);
+		}
+	}
+	return true;
+}
+
 static void
 gen_indexing_bounds_check(struct gen_context *ctx,
 	struct location loc,
@@ -312,35 +939,51 @@ gen_indexing_bounds_check(struct gen_context *ctx,
 static struct gen_value
 gen_access_index(struct gen_context *ctx, const struct expression *expr)
 {
-	struct gen_value glval = gen_expr(ctx, expr->access.array);
-	glval = gen_autoderef(ctx, glval);
 	struct qbe_value qival = mkqtmp(ctx, ctx->arch.ptr, ".%d");
 	bool checkbounds = !expr->access.bounds_checked;
 	struct qbe_value length, qlval;
-	const struct type *ty = type_dealias(NULL, glval.type);
-	switch (ty->storage) {
-	case STORAGE_SLICE:;
-		struct gen_slice sl = gen_slice_ptrs(ctx, glval);
-		load_slice_data(ctx, &sl, &qlval, &length, NULL);
-		break;
-	case STORAGE_ARRAY:
-		qlval = mkqval(ctx, &glval);
-		if (ty->array.length != SIZE_UNDEFINED) {
-			length = constl(ty->array.length);
-		} else {
-			checkbounds = false;
+	if (!gen_slice_parts(ctx, expr->access.array, &qlval, &length, NULL)) {
+		struct gen_value glval = gen_expr(ctx, expr->access.array);
+		glval = gen_autoderef(ctx, glval);
+		const struct type *ty = type_dealias(NULL, glval.type);
+		switch (ty->storage) {
+		case STORAGE_SLICE:;
+			struct gen_slice sl = gen_slice_ptrs(ctx, glval);
+			load_slice_data(ctx, &sl, &qlval, &length, NULL);
+			break;
+		case STORAGE_ARRAY:
+			qlval = mkqval(ctx, &glval);
+			if (ty->array.length != SIZE_UNDEFINED) {
+				length = constl(ty->array.length);
+			} else {
+				checkbounds = false;
+			}
+			break;
+		default:
+			assert(0); // Unreachable
 		}
-		break;
-	default:
-		assert(0); // Unreachable
 	}
 
 	struct gen_value index = gen_expr(ctx, expr->access.index);
 	struct qbe_value qindex = mkqval(ctx, &index);
-	struct qbe_value itemsz = constl(expr->result->size);
-	pushi(ctx->current, &qival, Q_MUL, &qindex, &itemsz, NULL);
-	pushi(ctx->current, &qival, Q_ADD, &qlval, &qival, NULL);
+	const struct gen_stride *stride = ctx->strides;
+	while (stride && stride->stride != expr->access.stride) {
+		stride = stride->next;
+	}
+	if (expr->access.stride && stride) {
+		pushi(ctx->current, &qival, Q_COPY, &stride->ptr, NULL);
+	} else {
+		struct qbe_value itemsz = constl(expr->result->size);
+		pushi(ctx->current, &qival, Q_MUL, &qindex, &itemsz, NULL);
+		pushi(ctx->current, &qival, Q_ADD, &qlval, &qival, NULL);
+	}
 
+	for (const struct gen_guarded *g = ctx->guarded;
+			checkbounds && g; g = g->next) {
+		if (g->loop == expr->access.guard) {
+			checkbounds = false;
+		}
+	}
 	if (checkbounds) {
 		gen_indexing_bounds_check(ctx, expr->loc, Q_CULTL, &qindex, &length);
 	}
@@ -413,9 +1056,52 @@ gen_expr_access_addr(struct gen_context *ctx, const struct expression *expr)
 	return addr;
 }
 
+// Scalar bindings whose address is never taken are kept in a temporary, which
+// qbe merges at control flow joins, rather than in a stack slot
+static bool
+binding_in_reg(const struct scope_object *obj)
+{
+	return !(obj->flags & SO_ADDRESS_TAKEN)
+		&& !type_is_aggregate(type_dealias(NULL, obj->type));
+}
+
+static const struct gen_binding *
+gen_reg_binding(struct gen_context *ctx, const struct expression *expr)
+{
+	const struct gen_binding *gb = gen_binding_lookup(ctx, expr);
+	return gb && gb->reg ? gb : NULL;
+}
+
+static struct gen_value
+gen_binding_load(struct gen_context *ctx, const struct gen_binding *gb)
+{
+	// The binding may be assigned before its value is used
+	return gen_copy_temp(ctx, gb->value);
+}
+
 static struct gen_value
 gen_expr_access(struct gen_context *ctx, const struct expression *expr)
 {
+	const struct gen_binding *gb = gen_reg_binding(ctx, expr);
+	if (gb) {
+		return gen_binding_load(ctx, gb);
+	}
+	const struct gen_part *part = NULL;
+	switch (expr->access.type) {
+	case ACCESS_FIELD:
+		part = gen_binding_part(ctx, expr->access._struct,
+			expr->access.field->offset);
+		break;
+	case ACCESS_TUPLE:
+		part = gen_binding_part(ctx, expr->access.tuple,
+			expr->access.tvalue->offset);
+		break;
+	default:
+		break;
+	}
+	if (part) {
+		return gen_copy_temp(ctx, part->value);
+	}
 	struct gen_value addr = gen_expr_access_addr(ctx, expr);
 	if (expr->result->size == 0) {
 		return addr;
@@ -423,6 +1109,184 @@ gen_expr_access(struct gen_context *ctx, const struct expression *expr)
 	return gen_load(ctx, addr);
 }
 
+// Allocations of at most this many bytes are placed on the stack if they do
+// not escape the function
+#define STACKALLOC_MAX 4096
+
+static struct gen_stackalloc *
+stackalloc_lookup(struct gen_context *ctx, const struct scope_object *object)
+{
+	for (struct gen_stackalloc *sa = ctx->stackallocs; sa; sa = sa->next) {
+		if (sa->object == object) {
+			return sa;
+		}
+	}
+	return NULL;
+}
+
+static void escape_expr(struct gen_context *ctx, const struct expression *expr);
+
+// The address of this expression is taken, so the local its storage is reached
+// through escapes
+static void
+escape_addr(struct gen_context *ctx, const struct expression *expr)
+{
+	if (expr->type == EXPR_UNARITHM && expr->unarithm.op == UN_DEREF) {
+		escape_addr(ctx, expr->unarithm.operand);
+		return;
+	}
+	if (expr->type != EXPR_ACCESS) {
+		escape_expr(ctx, expr);
+		return;
+	}
+	struct gen_stackalloc *sa;
+	switch (expr->access.type) {
+	case ACCESS_IDENTIFIER:
+		sa = stackalloc_lookup(ctx, expr->access.object);
+		if (sa) {
+			sa->escapes = true;
+		}
+		break;
+	case ACCESS_INDEX:
+		escape_addr(ctx, expr->access.array);
+		escape_expr(ctx, expr->access.index);
+		break;
+	case ACCESS_FIELD:
+		escape_addr(ctx, expr->access._struct);
+		break;
+	case ACCESS_TUPLE:
+		escape_addr(ctx, expr->access.tuple);
+		break;
+	}
+}
+
+// The value of this expression is only dereferenced, so a local it names does
+// not escape
+static void
+escape_deref(struct gen_context *ctx, const struct expression *expr)
+{
+	if (expr->type == EXPR_ACCESS
+			&& expr->access.type == ACCESS_IDENTIFIER) {
+		return;
+	}
+	escape_expr(ctx, expr);
+}
+
+static void
+escape_binding(struct gen_context *ctx, const struct expression *expr)
+{
+	for (const struct expression_binding *binding = &expr->binding;
+			binding; binding = binding->next) {
+		const struct expression *init = binding->initializer;
+		escape_expr(ctx, init);
+		if (binding->unpack || binding->object->otype != O_BIND
+				|| init->type != EXPR_ALLOC
+				|| init->alloc.kind != ALLOC_OBJECT) {
+			continue;
+		}
+		const struct type *type = type_dealias(NULL, init->result);
+		assert(type->storage == STORAGE_POINTER);
+		size_t size = type->pointer.referent->size;
+		if (size == 0 || size == SIZE_UNDEFINED || size > STACKALLOC_MAX) {
+			continue;
+		}
+		struct gen_stackalloc *sa = xcalloc(1, sizeof *sa);
+		sa->object = binding->object;
+		sa->alloc = init;
+		sa->next = ctx->stackallocs;
+		ctx->stackallocs = sa;
+	}
+}
+
+static void
+escape_visit(const struct expression *expr, void *ctx)
+{
+	escape_expr(ctx, expr);
+}
+
+// Finds the locals bound to an alloc in this expression, and marks those which
+// are used other than by dereferencing or freeing them: stored, returned,
+// passed to a function, reassigned, or with their address taken.
+static void
+escape_expr(struct gen_context *ctx, const struct expression *expr)
+{
+	if (expr == NULL) {
+		return;
+	}
+	switch (expr->type) {
+	case EXPR_ACCESS:
+		switch (expr->access.type) {
+		case ACCESS_IDENTIFIER:
+			escape_addr(ctx, expr);
+			break;
+		case ACCESS_INDEX:
+			escape_deref(ctx, expr->access.array);
+			escape_expr(ctx, expr->access.index);
+			break;
+		case ACCESS_FIELD:
+			escape_deref(ctx, expr->access._struct);
+			break;
+		case ACCESS_TUPLE:
+			escape_deref(ctx, expr->access.tuple);
+			break;
+		}
+		break;
+	case EXPR_BINDING:
+		escape_binding(ctx, expr);
+		break;
+	case EXPR_FOR:
+		if (expr->_for.kind == FOR_ACCUMULATOR) {
+			expr_children(expr, escape_visit, ctx);
+			break;
+		}
+		// The object iterated over is accessed by its address
+		for (const struct expression_binding *binding =
+				&expr->_for.bindings->binding;
+				binding; binding = binding->next) {
+			escape_addr(ctx, binding->initializer);
+		}
+		escape_expr(ctx, expr->_for.cond);
+		escape_expr(ctx, expr->_for.afterthought);
+		escape_expr(ctx, expr->_for.body);
+		break;
+	case EXPR_FREE:
+		escape_deref(ctx, expr->free.expr);
+		break;
+	case EXPR_SLICE:
+		escape_addr(ctx, expr->slice.object);
+		escape_expr(ctx, expr->slice.start);
+		escape_expr(ctx, expr->slice.end);
+		break;
+	case EXPR_UNARITHM:
+		switch (expr->unarithm.op) {
+		case UN_ADDRESS:
+			escape_addr(ctx, expr->unarithm.operand);
+			break;
+		case UN_DEREF:
+			escape_deref(ctx, expr->unarithm.operand);
+			break;
+		default:
+			escape_expr(ctx, expr->unarithm.operand);
+			break;
+		}
+		break;
+	default:
+		expr_children(expr, escape_visit, ctx);
+		break;
+	}
+}
+
+static bool
+alloc_on_stack(struct gen_context *ctx, const struct expression *alloc)
+{
+	for (struct gen_stackalloc *sa = ctx->stackallocs; sa; sa = sa->next) {
+		if (sa->alloc == alloc) {
+			return !sa->escapes;
+		}
+	}
+	return false;
+}
+
 static void
 gen_alloc_slice_at(struct gen_context *ctx,
 		const struct expression *expr,
@@ -551,9 +1415,16 @@ gen_expr_alloc_init_with(struct gen_context *ctx,
 	struct qbe_value sz = constl(objtype->size);
 	struct gen_value result = mkgtemp(ctx, expr->result, ".%d");
 	struct qbe_value qresult = mkqval(ctx, &result);
-	pushi(ctx->current, &qresult, Q_CALL, &ctx->rt.malloc, &sz, NULL);
+	bool stack = alloc_on_stack(ctx, expr);
+	if (stack) {
+		enum qbe_instr alloc = alloc_for_align(objtype->align);
+		pushprei(ctx->current, &qresult, alloc, &sz, NULL);
+	} else {
+		pushi(ctx->current, &qresult, Q_CALL, &ctx->rt.malloc, &sz, NULL);
+	}
 
-	if (!(type_dealias(NULL, expr->result)->pointer.flags & PTR_NULLABLE)) {
+	if (!stack && !(type_dealias(NULL, expr->result)->pointer.flags
+			& PTR_NULLABLE)) {
 		struct qbe_statement linvalid, lvalid;
 		struct qbe_value cmpres = mkqtmp(ctx, &qbe_word, ".%d");
 		struct qbe_value zero = constl(0);
@@ -707,13 +1578,7 @@ gen_expr_assert(struct gen_context *ctx, const struct expression *expr)
 
 	if (expr->assert.message) {
 		struct gen_value msg = gen_expr(ctx, expr->assert.message);
-		for (struct gen_scope *scope = ctx->scope;
-				scope; scope = scope->parent) {
-			gen_defers(ctx, scope);
-			if (scope->scope->class == SCOPE_DEFER) {
-				break;
-			}
-		}
+		gen_defers(ctx, defer_boundary(ctx->scope));
 		struct qbe_value path =
 			mklval(ctx, &ctx->sources[expr->loc.file]);
 		struct qbe_value line = constl(expr->loc.lineno);
@@ -954,6 +1819,21 @@ extend(struct gen_context *ctx, struct qbe_value v, const struct type *type)
 	return temp;
 }
 
+static void
+gen_binding_store(struct gen_context *ctx,
+	const struct gen_binding *gb,
+	struct gen_value value)
+{
+	if (value.type->size == 0 || value.type->storage == STORAGE_NEVER) {
+		return; // no storage
+	}
+	// Truncate the value as a store to memory would
+	struct qbe_value qval = mkqval(ctx, &value),
+		qreg = mkqval(ctx, &gb->value);
+	qval = extend(ctx, qval, type_dealias(NULL, gb->value.type));
+	pushi(ctx->current, &qreg, Q_COPY, &qval, NULL);
+}
+
 bool bin_extend[BIN_LAST + 1][2] = {
 	[BIN_BAND] = { false, false },
 	[BIN_BOR] = { false, false },
@@ -976,6 +1856,51 @@ bool bin_extend[BIN_LAST + 1][2] = {
 	[BIN_BXOR] = { false, false },
 };
 
+static struct gen_value
+gen_expr_assign_reg(struct gen_context *ctx,
+	const struct expression *expr,
+	const struct gen_binding *gb)
+{
+	struct expression *value = expr->assign.value;
+	if (expr->assign.op == BIN_LEQUAL || value->result->storage == STORAGE_NEVER) {
+		struct gen_value rvalue = gen_expr(ctx, value);
+		gen_binding_store(ctx, gb, rvalue);
+	} else if (expr->assign.op == BIN_LAND || expr->assign.op == BIN_LOR) {
+		struct qbe_statement lrval, lshort;
+		struct qbe_value brval = mklabel(ctx, &lrval, ".%d");
+		struct qbe_value bshort = mklabel(ctx, &lshort, ".%d");
+		struct qbe_value qreg = mkqval(ctx, &gb->value);
+		if (expr->binarithm.op == BIN_LAND) {
+			pushi(ctx->current, NULL, Q_JNZ, &qreg, &brval,
+				&bshort, NULL);
+		} else {
+			pushi(ctx->current, NULL, Q_JNZ, &qreg, &bshort,
+				&brval, NULL);
+		}
+		push(&ctx->current->body, &lrval);
+		gen_binding_store(ctx, gb, gen_expr(ctx, value));
+		pushi(ctx->current, NULL, Q_JMP, &bshort, NULL);
+		push(&ctx->current->body, &lshort);
+	} else {
+		struct gen_value lvalue = gen_binding_load(ctx, gb);
+		struct gen_value rvalue = gen_expr(ctx, value);
+		struct qbe_value qlval = mkqval(ctx, &lvalue);
+		struct qbe_value ilval = qlval;
+		struct qbe_value qrval = mkqval(ctx, &rvalue);
+		enum qbe_instr instr = binarithm_for_op(ctx,
+			expr->assign.op, lvalue.type);
+		if (bin_extend[expr->assign.op][0]) {
+			ilval = extend(ctx, ilval, lvalue.type);
+		}
+		if (bin_extend[expr->assign.op][1]) {
+			qrval = extend(ctx, qrval, rvalue.type);
+		}
+		pushi(ctx->current, &qlval, instr, &ilval, &qrval, NULL);
+		gen_binding_store(ctx, gb, lvalue);
+	}
+	return gv_void;
+}
+
 static struct gen_value
 gen_expr_assign(struct gen_context *ctx, const struct expression *expr)
 {
@@ -985,6 +1910,11 @@ gen_expr_assign(struct gen_context *ctx, const struct expression *expr)
 		return gen_expr_assign_slice(ctx, expr);
 	}
 
+	const struct gen_binding *gb = gen_reg_binding(ctx, object);
+	if (gb) {
+		return gen_expr_assign_reg(ctx, expr, gb);
+	}
+
 	struct gen_value obj;
 	switch (object->type) {
 	case EXPR_ACCESS:
@@ -1087,8 +2017,24 @@ gen_expr_binarithm(struct gen_context *ctx, const struct expression *expr)
 
 	assert((ltype->storage == STORAGE_STRING) == (rtype->storage == STORAGE_STRING));
 	if (ltype->storage == STORAGE_STRING) {
+		// Strings of different lengths compare unequal without a call
+		// to rt.strcmp
+		struct qbe_statement lcall, lend;
+		struct qbe_value bcall = mklabel(ctx, &lcall, ".%d");
+		struct qbe_value bend = mklabel(ctx, &lend, ".%d");
+		struct qbe_value llen, rlen;
+		struct gen_slice lsl = gen_slice_ptrs(ctx, lvalue);
+		struct gen_slice rsl = gen_slice_ptrs(ctx, rvalue);
+		load_slice_data(ctx, &lsl, NULL, &llen, NULL);
+		load_slice_data(ctx, &rsl, NULL, &rlen, NULL);
+		enum qbe_instr eq = binarithm_for_op(ctx,
+			BIN_LEQUAL, &builtin_type_size);
+		pushi(ctx->current, &qresult, eq, &llen, &rlen, NULL);
+		pushi(ctx->current, NULL, Q_JNZ, &qresult, &bcall, &bend, NULL);
+		push(&ctx->current->body, &lcall);
 		pushi(ctx->current, &qresult, Q_CALL,
 			&ctx->rt.strcmp, &qlval, &qrval, NULL);
+		push(&ctx->current->body, &lend);
 		if (expr->binarithm.op == BIN_NEQUAL) {
 			struct qbe_value one = constl(1);
 			pushi(ctx->current, &qresult, Q_XOR, &qresult, &one, NULL);
@@ -1207,11 +2153,19 @@ gen_expr_binding(struct gen_context *ctx, const struct expression *expr)
 		gb->next = ctx->bindings;
 		ctx->bindings = gb;
 
+		if (binding_in_reg(binding->object)) {
+			gb->reg = true;
+			gen_binding_store(ctx, gb,
+				gen_expr(ctx, binding->initializer));
+			continue;
+		}
+
 		struct qbe_value qv = mklval(ctx, &gb->value);
 		struct qbe_value sz = constl(type->size);
 		enum qbe_instr alloc = alloc_for_align(type->align);
 		pushprei(ctx->current, &qv, alloc, &sz, NULL);
 		gen_expr_at(ctx, binding->initializer, gb->value);
+		gen_binding_parts(ctx, gb);
 	}
 	return gv_void;
 }
@@ -1231,14 +2185,7 @@ gen_expr_control(struct gen_context *ctx, const struct expression *expr)
 		}
 	}
 
-	struct gen_scope *deferred = ctx->scope;
-	while (deferred != NULL) {
-		gen_defers(ctx, deferred);
-		if (deferred == scope) {
-			break;
-		}
-		deferred = deferred->parent;
-	}
+	gen_defers(ctx, scope);
 
 	switch (expr->type) {
 	case EXPR_BREAK:
@@ -1258,9 +2205,332 @@ gen_expr_control(struct gen_context *ctx, const struct expression *expr)
 	return gv_void;
 }
 
+// Functions whose bodies have at most this many expressions are inlined into
+// their callers in the same unit, up to this depth of nested inlined calls
+#define INLINE_COST_MAX 16
+#define INLINE_DEPTH_MAX 4
+
+struct inline_cost {
+	const struct declaration *decl;
+	size_t cost;
+	bool returns;
+};
+
+static void
+inline_cost_visit(const struct expression *expr, void *user)
+{
+	struct inline_cost *cost = user;
+	if (cost->cost > INLINE_COST_MAX) {
+		return;
+	}
+	++cost->cost;
+	switch (expr->type) {
+	case EXPR_BINDING:
+		// Static bindings are emitted once, with the function
+		for (const struct expression_binding *binding = &expr->binding;
+				binding; binding = binding->next) {
+			const struct scope_object *obj = binding->unpack
+				? binding->unpack->object : binding->object;
+			if (obj->otype == O_DECL) {
+				cost->cost = SIZE_MAX;
+				return;
+			}
+		}
+		break;
+	case EXPR_CALL:;
+		const struct expression *lvalue = expr->call.lvalue;
+		if (lvalue->type == EXPR_ACCESS
+				&& lvalue->access.type == ACCESS_IDENTIFIER
+				&& identifier_eq(&lvalue->access.object->ident,
+					&cost->decl->ident)) {
+			cost->cost = SIZE_MAX; // Recursive
+			return;
+		}
+		break;
+	case EXPR_RETURN:
+		cost->returns = true;
+		break;
+	case EXPR_VAARG:
+	case EXPR_VAEND:
+	case EXPR_VASTART:
+		cost->cost = SIZE_MAX;
+		return;
+	default:
+		break;
+	}
+	expr_children(expr, inline_cost_visit, user);
+}
+
+static bool
+inlinable(const struct declaration *decl)
+{
+	if (decl->decl_type != DECL_FUNC || decl->func.body == NULL
+			|| decl->func.flags != 0) {
+		return false;
+	}
+	const struct type *fntype = decl->func.type;
+	if (fntype->func.variadism != VARIADISM_NONE
+			|| fntype->func.result->storage == STORAGE_NEVER) {
+		return false;
+	}
+	struct inline_cost cost = { .decl = decl };
+	inline_cost_visit(decl->func.body, &cost);
+	if (decl->func.body->result->storage == STORAGE_NEVER
+			&& !cost.returns) {
+		return false; // Never returns to the caller
+	}
+	return cost.cost <= INLINE_COST_MAX;
+}
+
+// Whether a function may use a calling convention of its own when only calls
+// refer to it
+static bool
+local_callable(const struct declaration *decl)
+{
+	return decl->decl_type == DECL_FUNC && decl->func.body != NULL
+		&& decl->func.type->func.variadism != VARIADISM_C;
+}
+
+// Whether a function returns an aggregate which its callers could have it write
+// in place
+static bool
+placeable(const struct declaration *decl)
+{
+	const struct type *result = decl->func.type->func.result;
+	return result->storage != STORAGE_NEVER
+		&& result->size != 0 && result->size != SIZE_UNDEFINED
+		&& type_is_aggregate(result);
+}
+
+// Whether an aggregate parameter is never modified, so that its argument's
+// storage may be used in place of a copy
+static bool
+param_forwarded(const struct scope_object *obj)
+{
+	return obj->type->size != 0
+		&& !(obj->flags & (SO_ADDRESS_TAKEN | SO_ASSIGNED))
+		&& type_is_aggregate(type_dealias(NULL, obj->type));
+}
+
+// Returns the binding an argument refers to, if its storage is left alone
+// until the call returns and may be passed in place of a copy
+static const struct gen_binding *
+arg_forwardable(struct gen_context *ctx, const struct expression *expr)
+{
+	// Casts which need no conversion, such as from a const binding,
+	// evaluate to their operand's storage
+	while (expr->type == EXPR_CAST && expr->cast.kind == C_CAST) {
+		const struct type *to = type_dealias(NULL, expr->result),
+			*from = type_dealias(NULL, expr->cast.value->result);
+		if (to->storage != from->storage || to->size != from->size
+				|| to->storage == STORAGE_ARRAY
+				|| to->storage == STORAGE_TAGGED) {
+			break;
+		}
+		expr = expr->cast.value;
+	}
+	const struct gen_binding *gb = gen_binding_lookup(ctx, expr);
+	if (!gb || gb->reg || (gb->object->flags
+			& (SO_ADDRESS_TAKEN | SO_ASSIGNED))) {
+		return NULL;
+	}
+	return gb;
+}
+
+static const struct gen_local *
+local_lookup_decl(struct gen_context *ctx, const struct declaration *decl)
+{
+	for (const struct gen_local *lc = ctx->locals; lc; lc = lc->next) {
+		if (lc->decl == decl) {
+			return lc;
+		}
+	}
+	return NULL;
+}
+
+// Returns the function called, if only calls refer to it
+static const struct gen_local *
+local_lookup(struct gen_context *ctx, const struct expression *lvalue)
+{
+	if (lvalue->type != EXPR_ACCESS
+			|| lvalue->access.type != ACCESS_IDENTIFIER
+			|| lvalue->access.object->otype != O_DECL) {
+		return NULL;
+	}
+	for (const struct gen_local *lc = ctx->locals; lc; lc = lc->next) {
+		if (identifier_eq(&lc->decl->ident,
+				&lvalue->access.object->ident)) {
+			return lc;
+		}
+	}
+	return NULL;
+}
+
+// Returns the function to be inlined at a call, if any
+static const struct declaration *
+inline_lookup(struct gen_context *ctx, const struct expression *lvalue)
+{
+	if (lvalue->type != EXPR_ACCESS
+			|| lvalue->access.type != ACCESS_IDENTIFIER
+			|| lvalue->access.object->otype != O_DECL) {
+		return NULL;
+	}
+	const struct declaration *decl = NULL;
+	for (const struct gen_inline *il = ctx->inlines; il; il = il->next) {
+		if (identifier_eq(&il->decl->ident,
+				&lvalue->access.object->ident)) {
+			decl = il->decl;
+			break;
+		}
+	}
+	if (!decl) {
+		return NULL;
+	}
+	size_t depth = 0;
+	for (const struct gen_scope *scope = ctx->scope;
+			scope; scope = scope->parent) {
+		if (scope->scope->class != SCOPE_FUNC) {
+			continue;
+		}
+		if (scope->scope == decl->func.scope
+				|| ++depth == INLINE_DEPTH_MAX) {
+			return NULL;
+		}
+	}
+	return decl;
+}
+
+// Returns the scope of the innermost inlined function being generated, if any
+static struct gen_scope *
+inline_scope(struct gen_context *ctx)
+{
+	for (struct gen_scope *scope = ctx->scope;
+			scope; scope = scope->parent) {
+		if (scope->scope->class == SCOPE_FUNC) {
+			return scope;
+		}
+	}
+	return NULL;
+}
+
+// Whether a call's result may be written directly to out
+static bool
+call_writes_out(const struct type *result, const struct gen_value *out)
+{
+	return out && result->storage != STORAGE_NEVER
+		&& type_is_aggregate(result) && result->size != 0
+		&& type_dealias(NULL, out->type) == type_dealias(NULL, result);
+}
+
+static struct gen_value
+gen_expr_call_inline(struct gen_context *ctx,
+	const struct expression *expr,
+	const struct declaration *decl,
+	struct gen_value *dest)
+{
+	const struct type *result = decl->func.type->func.result;
+	struct gen_value gvout = mkgtemp(ctx, result, ".%d");
+	struct gen_value *out = NULL;
+	if (call_writes_out(result, dest)) {
+		gvout = *dest;
+		out = dest;
+	} else if (type_is_aggregate(result) && result->size != 0) {
+		// The result is a copy, as it would be for a call
+		struct qbe_value base = mklval(ctx, &gvout);
+		struct qbe_value sz = constl(result->size);
+		enum qbe_instr alloc = alloc_for_align(result->align);
+		pushprei(ctx->current, &base, alloc, &sz, NULL);
+		out = &gvout;
+	}
+
+	// Evaluate every argument before binding any parameter, as the
+	// arguments may themselves inline this function
+	size_t nargs = 0;
+	for (const struct call_argument *carg = expr->call.args;
+			carg; carg = carg->next) {
+		++nargs;
+	}
+	// Parameters kept in memory are either evaluated into storage of
+	// their own or, if neither side modifies it, share their argument's
+	struct gen_value *args = xcalloc(nargs, sizeof(struct gen_value));
+	size_t i = 0;
+	const struct scope_object *obj = decl->func.scope->objects;
+	for (const struct call_argument *carg = expr->call.args;
+			carg; carg = carg->next, obj = obj->lnext, ++i) {
+		const struct type *type = obj->type;
+		if (type->size == 0 || binding_in_reg(obj)
+				|| carg->value->result->storage == STORAGE_NEVER
+				|| (param_forwarded(obj)
+					&& arg_forwardable(ctx, carg->value))) {
+			args[i] = gen_expr(ctx, carg->value);
+		} else {
+			args[i] = mkgtemp(ctx, type, "param.%d");
+			struct qbe_value qv = mklval(ctx, &args[i]);
+			struct qbe_value sz = constl(type->size);
+			enum qbe_instr alloc = alloc_for_align(type->align);
+			pushprei(ctx->current, &qv, alloc, &sz, NULL);
+			gen_expr_at(ctx, carg->value, args[i]);
+		}
+		if (carg->value->result->storage == STORAGE_NEVER) {
+			free(args);
+			return gvout;
+		}
+	}
+
+	i = 0;
+	for (obj = decl->func.scope->objects; obj; obj = obj->lnext, ++i) {
+		const struct type *type = obj->type;
+		if (type->size == 0) {
+			continue;
+		}
+		struct gen_binding *gb = xcalloc(1, sizeof(struct gen_binding));
+		gb->object = obj;
+		gb->next = ctx->bindings;
+		ctx->bindings = gb;
+		if (binding_in_reg(obj)) {
+			gb->value = mkgtemp(ctx, type, "param.%d");
+			gb->reg = true;
+			gen_binding_store(ctx, gb, args[i]);
+			continue;
+		}
+		gb->value = args[i];
+		gb->value.type = type;
+		gen_binding_parts(ctx, gb);
+	}
+	free(args);
+
+	struct qbe_statement lend;
+	struct qbe_value bend = mklabel(ctx, &lend, ".%d");
+	struct gen_scope *scope = push_scope(ctx, decl->func.scope);
+	scope->end = &bend;
+	scope->out = out;
+	scope->result = gvout;
+	struct gen_value ret = gen_expr_with(ctx, decl->func.body, out);
+	branch_copyresult(ctx, ret, gvout, out);
+	pop_scope(ctx);
+	push(&ctx->current->body, &lend);
+	return gvout;
+}
+
+// Calls a function, writing an aggregate result to out if it is not NULL
 static struct gen_value
-gen_expr_call(struct gen_context *ctx, const struct expression *expr)
+gen_expr_call_with(struct gen_context *ctx,
+	const struct expression *expr,
+	struct gen_value *out)
 {
+	const struct declaration *decl = inline_lookup(ctx, expr->call.lvalue);
+	if (decl) {
+		struct gen_value rval =
+			gen_expr_call_inline(ctx, expr, decl, out);
+		if (out && !call_writes_out(decl->func.type->func.result, out)
+				&& expr->result->storage != STORAGE_NEVER) {
+			gen_store(ctx, *out, rval);
+			return *out;
+		}
+		return rval;
+	}
+	const struct gen_local *local = local_lookup(ctx, expr->call.lvalue);
+
 	struct gen_value lvalue = gen_expr(ctx, expr->call.lvalue);
 	lvalue = gen_autoderef(ctx, lvalue);
 
@@ -1272,23 +2542,60 @@ gen_expr_call(struct gen_context *ctx, const struct expression *expr)
 		.instr = Q_CALL,
 	};
 	struct gen_value rval = gv_void;
-	if (rtype->func.result->size != 0
+	struct qbe_arguments *args, **next = &call.args;
+	args = *next = xcalloc(1, sizeof(struct qbe_arguments));
+	args->value = mkqval(ctx, &lvalue);
+	next = &args->next;
+
+	bool placed = local && local->placed;
+	if (placed && call_writes_out(rtype->func.result, out)) {
+		rval = *out;
+	} else if (placed) {
+		rval = mkgtemp(ctx, rtype->func.result, ".%d");
+		struct qbe_value base = mklval(ctx, &rval);
+		struct qbe_value sz = constl(rtype->func.result->size);
+		enum qbe_instr alloc = alloc_for_align(rtype->func.result->align);
+		pushprei(ctx->current, &base, alloc, &sz, NULL);
+	} else if (rtype->func.result->size != 0
 			&& rtype->func.result->size != SIZE_UNDEFINED) {
 		rval = mkgtemp(ctx, rtype->func.result, ".%d");
 		call.out = xcalloc(1, sizeof(struct qbe_value));
 		*call.out = mkqval(ctx, &rval);
 		call.out->type = qtype_lookup(ctx, rtype->func.result, false);
 	}
+	if (placed) {
+		// The result's address is passed before the arguments
+		args = *next = xcalloc(1, sizeof(struct qbe_arguments));
+		args->value = mklval(ctx, &rval);
+		args->value.type = ctx->arch.ptr;
+		next = &args->next;
+	}
 
 	bool cvar = false;
 	struct type_func_param *param = rtype->func.params;
-	struct qbe_arguments *args, **next = &call.args;
-	args = *next = xcalloc(1, sizeof(struct qbe_arguments));
-	args->value = mkqval(ctx, &lvalue);
-	next = &args->next;
+	const struct scope_object *obj =
+		local ? local->decl->func.scope->objects : NULL;
 	for (struct call_argument *carg = expr->call.args;
 			carg; carg = carg->next) {
-		struct gen_value arg = gen_expr(ctx, carg->value);
+		bool forwarded = obj && param_forwarded(obj);
+		if (obj) {
+			obj = obj->lnext;
+		}
+		struct gen_value arg;
+		if (forwarded && !arg_forwardable(ctx, carg->value)
+				&& carg->value->result->storage != STORAGE_NEVER) {
+			// The callee is passed the address of its own copy,
+			// which the argument is evaluated into
+			arg = mkgtemp(ctx, carg->value->result, "arg.%d");
+			struct qbe_value base = mklval(ctx, &arg);
+			struct qbe_value sz = constl(carg->value->result->size);
+			enum qbe_instr alloc =
+				alloc_for_align(carg->value->result->align);
+			pushprei(ctx->current, &base, alloc, &sz, NULL);
+			gen_expr_at(ctx, carg->value, arg);
+		} else {
+			arg = gen_expr(ctx, carg->value);
+		}
 		if (carg->value->result->size == 0) {
 			continue;
 		}
@@ -1297,7 +2604,12 @@ gen_expr_call(struct gen_context *ctx, const struct expression *expr)
 			return rval;
 		}
 		args->value = mkqval(ctx, &arg);
-		args->value.type = qtype_lookup(ctx, carg->value->result, false);
+		if (forwarded) {
+			args->value.type = ctx->arch.ptr;
+		} else {
+			args->value.type = qtype_lookup(ctx,
+				carg->value->result, false);
+		}
 		next = &args->next;
 		if (param) {
 			param = param->next;
@@ -1311,13 +2623,7 @@ gen_expr_call(struct gen_context *ctx, const struct expression *expr)
 	}
 
 	if (rtype->func.result->storage == STORAGE_NEVER) {
-		for (struct gen_scope *scope = ctx->scope; scope;
-				scope = scope->parent) {
-			gen_defers(ctx, scope);
-			if (scope->scope->class == SCOPE_DEFER) {
-				break;
-			}
-		}
+		gen_defers(ctx, defer_boundary(ctx->scope));
 	}
 
 	push(&ctx->current->body, &call);
@@ -1325,6 +2631,11 @@ gen_expr_call(struct gen_context *ctx, const struct expression *expr)
 		pushi(ctx->current, NULL, Q_HLT, NULL);
 	}
 
+	if (out && !(placed && call_writes_out(rtype->func.result, out))
+			&& rtype->func.result->storage != STORAGE_NEVER) {
+		gen_store(ctx, *out, rval);
+		return *out;
+	}
 	return rval;
 }
 
@@ -1504,6 +2815,11 @@ gen_expr_cast_array_at(struct gen_context *ctx,
 {
 	const struct type *typeout = type_dealias(NULL, expr->result);
 	const struct type *typein = type_dealias(NULL, expr->cast.value->result);
+	if (typein->array.expandable && literal_is_zero(expr->cast.value)) {
+		struct qbe_value base = mklval(ctx, &out);
+		gen_zero_at(ctx, &base, typeout->size, typeout->align);
+		return;
+	}
 	gen_expr_at(ctx, expr->cast.value, out);
 	if (!typein->array.expandable) {
 		return;
@@ -1534,13 +2850,7 @@ gen_expr_cast_array_at(struct gen_context *ctx,
 		return;
 	}
 
-	offs = constl(typein->array.length * membtype->size);
-	pushi(ctx->current, &ptr, Q_ADD, &base, &offs, NULL);
-
-	struct qbe_value dtemp = mklval(ctx, &next);
-	struct qbe_value stemp = mklval(ctx, &item);
-	struct qbe_value sz = constl(remain * membtype->size);
-	pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memcpy, &dtemp, &stemp, &sz, NULL);
+	gen_fill_repeat(ctx, &qitem, membtype->size, remain);
 }
 
 static void
@@ -1884,6 +3194,18 @@ gen_expr_compound_with(struct gen_context *ctx,
 	return gvout;
 }
 
+// Returns the number of consecutive array members, out of the n remaining,
+// which are initialized from the given array literal item. The last item is
+// repeated to fill the remainder of the array.
+static size_t
+array_literal_run(const struct array_literal *item, size_t n)
+{
+	if (!item->next || item->repeat >= n) {
+		return n;
+	}
+	return item->repeat + 1;
+}
+
 static void
 gen_literal_array_at(struct gen_context *ctx,
 	const struct expression *expr,
@@ -1902,7 +3224,10 @@ gen_literal_array_at(struct gen_context *ctx,
 		ptr = mklval(ctx, &item);
 		pushi(ctx->current, &ptr, Q_ADD, &base, &offs, NULL);
 		gen_expr_at(ctx, ac->value, item);
-		++n;
+		if (ac->repeat != 0) {
+			gen_fill_repeat(ctx, &ptr, msize, ac->repeat);
+		}
+		n += ac->repeat + 1;
 	}
 	assert(n == atype->array.length);
 	if (!atype->array.expandable || n == 0) {
@@ -1914,12 +3239,10 @@ gen_literal_array_at(struct gen_context *ctx,
 		return;
 	}
 
-	struct qbe_value nsize = constl(n * msize);
-	struct qbe_value next = mkqtmp(ctx, ctx->arch.ptr, ".%d");
-	pushi(ctx->current, &next, Q_ADD, &base, &nsize, NULL);
-
-	struct qbe_value qlen = constl((arr.length - n) * msize);
-	pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memcpy, &next, &ptr, &qlen, NULL);
+	struct qbe_value offs = constl((n - 1) * msize);
+	struct qbe_value last = mkqtmp(ctx, ctx->arch.ptr, ".%d");
+	pushi(ctx->current, &last, Q_ADD, &base, &offs, NULL);
+	gen_fill_repeat(ctx, &last, msize, arr.length - n);
 }
 
 static void
@@ -1948,7 +3271,11 @@ gen_literal_slice_at(struct gen_context *ctx,
 			ptr = mklval(ctx, &item);
 			pushi(ctx->current, &ptr, Q_ADD, &aobj, &offs, NULL);
 			gen_expr_at(ctx, ac->value, item);
-			++n;
+			if (ac->repeat != 0) {
+				gen_fill_repeat(ctx, &ptr,
+					first->result->size, ac->repeat);
+			}
+			n += ac->repeat + 1;
 		}
 		struct qbe_value asz = constl(n);
 		enum qbe_instr alloc = alloc_for_align(first->result->align);
@@ -2051,6 +3378,90 @@ gen_literal_tuple_at(struct gen_context *ctx,
 	}
 }
 
+// Returns true if the given literal is composed entirely of constants which
+// can be stored in a data section, and counts the number of stores which
+// would be required to initialize it at runtime.
+static bool
+literal_is_constant(const struct expression *expr, size_t *nstores)
+{
+	if (expr->type != EXPR_LITERAL) {
+		return false;
+	}
+	const struct type *type = type_dealias(NULL, expr->result);
+	switch (type->storage) {
+	case STORAGE_ARRAY:
+		if (type->array.expandable) {
+			return false;
+		}
+		for (const struct array_literal *c = expr->literal.array;
+				c; c = c->next) {
+			size_t n = 0;
+			if (!literal_is_constant(c->value, &n)) {
+				return false;
+			}
+			*nstores += n * (c->repeat + 1);
+		}
+		return true;
+	case STORAGE_STRUCT:
+		for (const struct struct_literal *f = expr->literal._struct;
+				f; f = f->next) {
+			if (!literal_is_constant(f->value, nstores)) {
+				return false;
+			}
+		}
+		return true;
+	case STORAGE_TUPLE:
+		for (const struct tuple_literal *t = expr->literal.tuple;
+				t; t = t->next) {
+			if (!literal_is_constant(t->value, nstores)) {
+				return false;
+			}
+		}
+		return true;
+	case STORAGE_TAGGED:
+		++*nstores;
+		return literal_is_constant(expr->literal.tagged.value, nstores);
+	case STORAGE_STRING:
+		*nstores += 3;
+		return true;
+	case STORAGE_SLICE:
+		// The backing array of a slice literal is allocated for each
+		// evaluation, and must not be shared
+	case STORAGE_UNION:
+		return false;
+	default:
+		++*nstores;
+		return true;
+	}
+}
+
+// Initializes an aggregate from a constant literal by copying it from a
+// read-only data definition, rather than storing each member in turn.
+static void
+gen_literal_static_at(struct gen_context *ctx,
+	const struct expression *expr, struct gen_value out)
+{
+	struct qbe_def *def = xcalloc(1, sizeof(struct qbe_def));
+	def->kind = Q_DATA;
+	def->data.align = ALIGN_UNDEFINED;
+	def->exported = false;
+	def->name = gen_name(&ctx->id, "rodata.%d");
+	def->file = expr->loc.file;
+	size_t n = snprintf(NULL, 0, ".rodata.%s", def->name);
+	def->data.section = xcalloc(n + 1, 1);
+	snprintf(def->data.section, n + 1, ".rodata.%s", def->name);
+	gen_data_item(ctx, expr, &def->data.items);
+	qbe_append_def(ctx->out, def);
+
+	struct gen_value src = {
+		.kind = GV_GLOBAL,
+		.type = expr->result,
+		.name = xstrdup(def->name),
+	};
+	out.type = expr->result;
+	gen_copy_aligned(ctx, out, src);
+}
+
 static void
 gen_expr_literal_at(struct gen_context *ctx,
 	const struct expression *expr, struct gen_value out)
@@ -2061,7 +3472,26 @@ gen_expr_literal_at(struct gen_context *ctx,
 		return;
 	}
 
-	switch (type_dealias(NULL, expr->result)->storage) {
+	const struct type *type = type_dealias(NULL, expr->result);
+	if (literal_is_zero(expr)) {
+		size_t size = expr->result->size;
+		if (type->storage == STORAGE_ARRAY && type->array.expandable) {
+			assert(out.type);
+			size = type_dealias(NULL, out.type)->size;
+		}
+		struct qbe_value base = mklval(ctx, &out);
+		gen_zero_at(ctx, &base, size, expr->result->align);
+		return;
+	}
+
+	// Small aggregates are cheaper to initialize in place
+	size_t nstores = 0;
+	if (literal_is_constant(expr, &nstores) && nstores > 4) {
+		gen_literal_static_at(ctx, expr, out);
+		return;
+	}
+
+	switch (type->storage) {
 	case STORAGE_ARRAY:
 		gen_literal_array_at(ctx, expr, out);
 		break;
@@ -2157,6 +3587,7 @@ gen_expr_defer(struct gen_context *ctx, const struct expression *expr)
 {
 	struct gen_defer *defer = xcalloc(1, sizeof(struct gen_defer));
 	defer->expr = expr;
+	defer->block = mklabel(ctx, &defer->label, "defer.%d");
 	defer->next = ctx->scope->defers;
 	ctx->scope->defers = defer;
 	return gv_void;
@@ -2222,8 +3653,43 @@ gen_expr_delete(struct gen_context *ctx, const struct expression *expr)
 	return gv_void;
 }
 
-static struct gen_value
-gen_expr_for(struct gen_context *ctx, const struct expression *expr)
+// Computes the addresses of the elements indexed by the loop's induction
+// variable as the loop is entered
+static void
+gen_strides(struct gen_context *ctx, const struct expression *expr)
+{
+	for (const struct for_stride *stride = expr->_for.strides;
+			stride; stride = stride->next) {
+		// The array may be bound within the loop
+		if (!gen_binding_lookup(ctx, stride->array)) {
+			continue;
+		}
+		struct qbe_value base;
+		const struct type *atype = type_dealias(NULL, stride->array->result);
+		if (atype->storage == STORAGE_SLICE) {
+			if (!gen_slice_parts(ctx, stride->array, &base, NULL, NULL)) {
+				continue;
+			}
+		} else {
+			struct gen_value array = gen_expr(ctx, stride->array);
+			base = mkqval(ctx, &array);
+		}
+
+		struct gen_value index = gen_expr(ctx, stride->index);
+		struct qbe_value qindex = mkqval(ctx, &index);
+		struct qbe_value size = constl(stride->size);
+		struct gen_stride *gs = xcalloc(1, sizeof(struct gen_stride));
+		gs->stride = stride;
+		gs->ptr = mkqtmp(ctx, ctx->arch.ptr, "stride.%d");
+		pushi(ctx->current, &gs->ptr, Q_MUL, &qindex, &size, NULL);
+		pushi(ctx->current, &gs->ptr, Q_ADD, &base, &gs->ptr, NULL);
+		gs->next = ctx->strides;
+		ctx->strides = gs;
+	}
+}
+
+static void
+gen_for(struct gen_context *ctx, const struct expression *expr)
 {
 	struct qbe_statement lloop, lbody, lvalid, lafter, lend;
 	struct qbe_value bloop = mklabel(ctx, &lloop, "loop.%d");
@@ -2233,13 +3699,18 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 	struct qbe_value bafter = mklabel(ctx, &lafter, "after.%d");
 
 	struct gen_value gcur_object, ginitializer, gptr;
-	struct qbe_value qcur_object, qinitializer, qptr, qcur_idx, qlength;
+	struct qbe_value qcur_object, qinitializer, qptr, qlength, qend;
+	size_t membsz = 0;
 
 	enum for_kind kind = expr->_for.kind;
+	struct gen_stride *strides = ctx->strides;
 
 	if (kind == FOR_ACCUMULATOR && expr->_for.bindings != NULL) {
 		gen_expr_binding(ctx, expr->_for.bindings);
 	}
+	if (kind == FOR_ACCUMULATOR) {
+		gen_strides(ctx, expr);
+	}
 
 	if (kind == FOR_EACH_VALUE || kind == FOR_EACH_POINTER) {
 		ginitializer = gen_autoderef(ctx, gen_expr(ctx,
@@ -2284,9 +3755,14 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 			};
 		}
 
-		struct qbe_value qzero = constl(0);
-		qcur_idx = mkqtmp(ctx, ctx->arch.sz, "cur_idx.%d");
-		pushi(ctx->current, &qcur_idx, Q_COPY, &qzero, NULL);
+		// Members are never of size zero, so the loop ends when the
+		// pointer to the current member reaches the end of the array
+		membsz = initializer_type->array.members->size;
+		assert(membsz != 0); // Invariant
+		struct qbe_value qmembsz = constl(membsz);
+		qend = mkqtmp(ctx, ctx->arch.ptr, "end.%d");
+		pushi(ctx->current, &qend, Q_MUL, &qlength, &qmembsz, NULL);
+		pushi(ctx->current, &qend, Q_ADD, &qptr, &qend, NULL);
 	}
 
 	push_scope(ctx, expr->_for.scope);
@@ -2300,7 +3776,7 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 	case FOR_EACH_POINTER: {
 		struct qbe_value qvalid = mkqtmp(ctx, &qbe_word, "valid.%d");
 
-		pushi(ctx->current, &qvalid, Q_CULTL, &qcur_idx, &qlength, NULL);
+		pushi(ctx->current, &qvalid, Q_CULTL, &qptr, &qend, NULL);
 		pushi(ctx->current, NULL, Q_JNZ, &qvalid, &bvalid, &bend, NULL);
 		push(&ctx->current->body, &lvalid);
 
@@ -2354,8 +3830,6 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 				&qcur_object, NULL);
 		}
 
-		struct qbe_value qone = constl(1);
-		pushi(ctx->current, &qcur_idx, Q_ADD, &qcur_idx, &qone, NULL);
 		break;
 	}
 	case FOR_EACH_ITERATOR:
@@ -2461,10 +3935,17 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 		gen_expr(ctx, expr->_for.afterthought);
 	}
 	if (kind == FOR_EACH_VALUE || kind == FOR_EACH_POINTER) {
-		struct qbe_value qmember_sz = constl(
-			type_dealias(NULL, ginitializer.type)->array.members->size);
+		struct qbe_value qmember_sz = constl(membsz);
 		pushi(ctx->current, &qptr, Q_ADD, &qptr, &qmember_sz, NULL);
 	}
+	while (ctx->strides != strides) {
+		struct gen_stride *gs = ctx->strides;
+		struct qbe_value step = constl(
+			(uint64_t)gs->stride->step * gs->stride->size);
+		pushi(ctx->current, &gs->ptr, Q_ADD, &gs->ptr, &step, NULL);
+		ctx->strides = gs->next;
+		free(gs);
+	}
 
 	gen_defers(ctx, ctx->scope);
 	pop_scope(ctx);
@@ -2472,6 +3953,40 @@ gen_expr_for(struct gen_context *ctx, const struct expression *expr)
 	pushi(ctx->current, NULL, Q_JMP, &bloop, NULL);
 
 	push(&ctx->current->body, &lend);
+}
+
+static struct gen_value
+gen_expr_for(struct gen_context *ctx, const struct expression *expr)
+{
+	if (!expr->_for.guard) {
+		gen_for(ctx, expr);
+		return gv_void;
+	}
+
+	// The loop is generated twice, and the copy without the bounds checks
+	// which its guard makes redundant runs if the guard holds
+	struct qbe_statement lguarded, lchecked, lend;
+	struct qbe_value bguarded = mklabel(ctx, &lguarded, "guarded.%d");
+	struct qbe_value bchecked = mklabel(ctx, &lchecked, "checked.%d");
+	struct qbe_value bend = mklabel(ctx, &lend, ".%d");
+
+	struct gen_value guard = gen_expr(ctx, expr->_for.guard);
+	struct qbe_value qguard = mkqval(ctx, &guard);
+	pushi(ctx->current, NULL, Q_JNZ, &qguard, &bguarded, &bchecked, NULL);
+
+	push(&ctx->current->body, &lguarded);
+	struct gen_guarded guarded = {
+		.loop = expr,
+		.next = ctx->guarded,
+	};
+	ctx->guarded = &guarded;
+	gen_for(ctx, expr);
+	ctx->guarded = guarded.next;
+	pushi(ctx->current, NULL, Q_JMP, &bend, NULL);
+
+	push(&ctx->current->body, &lchecked);
+	gen_for(ctx, expr);
+	push(&ctx->current->body, &lend);
 	return gv_void;
 }
 
@@ -2482,6 +3997,15 @@ gen_expr_free(struct gen_context *ctx, const struct expression *expr)
 	if (type->storage == STORAGE_NULL) {
 		return gv_void;
 	}
+	const struct expression *object = expr->free.expr;
+	if (object->type == EXPR_ACCESS
+			&& object->access.type == ACCESS_IDENTIFIER) {
+		const struct gen_stackalloc *sa =
+			stackalloc_lookup(ctx, object->access.object);
+		if (sa && !sa->escapes) {
+			return gv_void; // Allocated on the stack
+		}
+	}
 	struct gen_value val = gen_expr(ctx, expr->free.expr);
 	struct qbe_value qval = mkqval(ctx, &val);
 	if (type->storage == STORAGE_SLICE || type->storage == STORAGE_STRING) {
@@ -2557,7 +4081,7 @@ gen_expr_append_insert(struct gen_context *ctx, const struct expression *expr)
 	slice = gen_autoderef(ctx, slice);
 	struct qbe_value prevlen, cap;
 	struct gen_slice sl = gen_slice_ptrs(ctx, slice);
-	load_slice_data(ctx, &sl, NULL, &prevlen, expr->append.is_static ? &cap : NULL);
+	load_slice_data(ctx, &sl, NULL, &prevlen, &cap);
 
 	enum qbe_instr load = load_for_type(ctx, &builtin_type_size);
 	struct qbe_value qindex, *qindex_ptr;
@@ -2616,21 +4140,27 @@ gen_expr_append_insert(struct gen_context *ctx, const struct expression *expr)
 	struct qbe_value ptr = mkqtmp(ctx, ctx->arch.ptr, ".%d");
 	const struct type *mtype = type_dealias(NULL, slice.type)->array.members;
 	struct qbe_value membsz = constl(mtype->size);
+	// The slice only has to grow if the new length exceeds its capacity,
+	// which is left to an out-of-line call to rt.ensure
+	struct qbe_statement lvalid, linvalid;
+	struct qbe_value bvalid = mklabel(ctx, &lvalid, ".%d");
+	struct qbe_value binvalid = mklabel(ctx, &linvalid, ".%d");
+	struct qbe_value valid = mkqtmp(ctx, &qbe_word, ".%d");
+	pushi(ctx->current, &valid, Q_CULEL, &newlen, &cap, NULL);
+	pushi(ctx->current, NULL, Q_JNZ, &valid, &bvalid, &binvalid, NULL);
+
 	if (!expr->append.is_static) {
+		struct qbe_statements body = begin_cold(ctx);
+		push(&ctx->current->body, &linvalid);
 		struct qbe_value lval = mklval(ctx, &slice);
 		pushi(ctx->current, NULL, Q_CALL, &ctx->rt.ensure, &lval, &membsz, NULL);
+		pushi(ctx->current, NULL, Q_JMP, &bvalid, NULL);
+		end_cold(ctx, body);
 	} else {
-		struct qbe_statement lvalid, linvalid;
-		struct qbe_value bvalid = mklabel(ctx, &lvalid, ".%d");
-		struct qbe_value binvalid = mklabel(ctx, &linvalid, ".%d");
-		struct qbe_value valid = mkqtmp(ctx, &qbe_word, ".%d");
-		pushi(ctx->current, &valid, Q_CULEL, &newlen, &cap, NULL);
-		pushi(ctx->current, NULL, Q_JNZ, &valid, &bvalid, &binvalid, NULL);
-
 		push(&ctx->current->body, &linvalid);
 		gen_fixed_abort(ctx, expr->loc, ABORT_OOB);
-		push(&ctx->current->body, &lvalid);
 	}
+	push(&ctx->current->body, &lvalid);
 
 	struct qbe_value base = mkqtmp(ctx, ctx->arch.ptr, ".%d");
 	pushi(ctx->current, &base, load, &sl.base, NULL);
@@ -2825,6 +4355,179 @@ gen_subset_match_tests(struct gen_context *ctx,
 	return match;
 }
 
+// Binds the matched object for a case of a match on a tagged union, if
+// needed, and emits the body of the case
+static void
+gen_match_case_tagged(struct gen_context *ctx,
+	const struct match_case *_case,
+	enum match_compat compat,
+	struct gen_value object,
+	struct gen_value gvout,
+	struct gen_value *out,
+	struct qbe_value *bout)
+{
+	if (!_case->object || _case->type->size == 0) {
+		goto next;
+	}
+
+	struct gen_binding *gb = xcalloc(1, sizeof(struct gen_binding));
+	gb->value = mkgtemp(ctx, _case->type, "binding.%d");
+	gb->object = _case->object;
+	gb->next = ctx->bindings;
+	ctx->bindings = gb;
+
+	struct qbe_value qv = mklval(ctx, &gb->value);
+	enum qbe_instr alloc = alloc_for_align(_case->type->align);
+	struct qbe_value sz = constl(_case->type->size);
+	pushprei(ctx->current, &qv, alloc, &sz, NULL);
+
+	struct qbe_value qobject = mkqval(ctx, &object);
+	struct qbe_value ptr = mkqtmp(ctx, ctx->arch.ptr, ".%d");
+	struct gen_value src = {
+		.kind = GV_TEMP,
+		.type = _case->type,
+		.name = ptr.name,
+	};
+	struct gen_value load;
+	struct qbe_value offset;
+	switch (compat) {
+	case COMPAT_SUBTYPE:
+		offset = nested_tagged_offset(object.type, _case->type);
+		pushi(ctx->current, &ptr, Q_ADD, &qobject, &offset, NULL);
+		load = gen_load(ctx, src);
+		gen_store(ctx, gb->value, load);
+		break;
+	case COMPAT_SUBSET:
+		pushi(ctx->current, &ptr, Q_COPY, &qobject, NULL);
+		load = gen_load(ctx, src);
+		gen_store(ctx, gb->value, load);
+		break;
+	}
+
+next:;
+	struct gen_value bval = gen_expr_with(ctx, _case->value, out);
+	branch_copyresult(ctx, bval, gvout, out);
+	if (_case->value->result->storage != STORAGE_NEVER) {
+		pushi(ctx->current, NULL, Q_JMP, bout, NULL);
+	}
+}
+
+// Lowers a match on a tagged union into a binary search over the type IDs
+// which may be found in its tag. Subset cases are flattened into the IDs of
+// their members, and an ID which appears in several cases selects the first.
+// The default case, if any, is left for the caller to generate. Returns false
+// if the match is better served by a chain of tests, which is also the case
+// when some case must look into the tag of a nested tagged union.
+static bool
+gen_match_tagged_search(struct gen_context *ctx,
+	const struct expression *expr,
+	struct gen_value object,
+	struct qbe_value *tag,
+	struct gen_value gvout,
+	struct gen_value *out,
+	struct qbe_value *bout,
+	const struct match_case **_default)
+{
+	const struct type *objtype = expr->match.value->result;
+	size_t ncases = 0, nids = 0;
+	for (const struct match_case *_case = expr->match.cases;
+			_case; _case = _case->next) {
+		++ncases;
+		if (!_case->type) {
+			continue;
+		}
+		const struct type *test =
+			tagged_select_subtype(NULL, objtype, _case->type, false);
+		if (!test) {
+			const struct type *casetype =
+				type_dealias(NULL, _case->type);
+			for (const struct type_tagged_union *tu = &casetype->tagged;
+					tu; tu = tu->next) {
+				++nids;
+			}
+		} else if (test->id == _case->type->id
+				|| type_dealias(NULL, test)->id == _case->type->id) {
+			++nids;
+		} else {
+			return false;
+		}
+	}
+	if (nids < SWITCH_RANGES_MIN) {
+		return false;
+	}
+
+	struct qbe_statement *lcases = xcalloc(ncases, sizeof(struct qbe_statement));
+	struct qbe_value *bcases = xcalloc(ncases, sizeof(struct qbe_value));
+	struct switch_range *ranges = xcalloc(nids, sizeof(struct switch_range));
+	size_t i = 0, n = 0;
+	for (const struct match_case *_case = expr->match.cases;
+			_case; _case = _case->next, ++i) {
+		if (!_case->type) {
+			*_default = _case;
+			continue;
+		}
+		bcases[i] = mklabel(ctx, &lcases[i], "matches.%d");
+		const struct type *test =
+			tagged_select_subtype(NULL, objtype, _case->type, false);
+		if (test) {
+			ranges[n++] = (struct switch_range){
+				.lo = test->id,
+				.hi = test->id,
+				._case = i,
+			};
+			continue;
+		}
+		const struct type *casetype = type_dealias(NULL, _case->type);
+		for (const struct type_tagged_union *tu = &casetype->tagged;
+				tu; tu = tu->next) {
+			ranges[n++] = (struct switch_range){
+				.lo = tu->type->id,
+				.hi = tu->type->id,
+				._case = i,
+			};
+		}
+	}
+
+	// qsort is not stable, so the first case for each ID is kept by hand
+	qsort(ranges, nids, sizeof(struct switch_range), switch_range_compar);
+	n = 0;
+	for (size_t j = 0; j < nids; ++j) {
+		if (n != 0 && ranges[n - 1].lo == ranges[j].lo) {
+			if (ranges[j]._case < ranges[n - 1]._case) {
+				ranges[n - 1]._case = ranges[j]._case;
+			}
+			continue;
+		}
+		ranges[n++] = ranges[j];
+	}
+
+	struct qbe_statement ldefault;
+	struct qbe_value bdefault = mklabel(ctx, &ldefault, "default.%d");
+	gen_switch_search(ctx, &builtin_type_u32, tag, ranges, n,
+		bcases, &bdefault);
+
+	i = 0;
+	for (const struct match_case *_case = expr->match.cases;
+			_case; _case = _case->next, ++i) {
+		if (!_case->type) {
+			continue;
+		}
+		enum match_compat compat = COMPAT_SUBSET;
+		if (tagged_select_subtype(NULL, objtype, _case->type, false)) {
+			compat = COMPAT_SUBTYPE;
+		}
+		push(&ctx->current->body, &lcases[i]);
+		gen_match_case_tagged(ctx, _case, compat, object,
+			gvout, out, bout);
+	}
+	push(&ctx->current->body, &ldefault);
+
+	free(lcases);
+	free(bcases);
+	free(ranges);
+	return true;
+}
+
 static struct gen_value
 gen_match_with_tagged(struct gen_context *ctx,
 	const struct expression *expr,
@@ -2844,9 +4547,13 @@ gen_match_with_tagged(struct gen_context *ctx,
 	struct qbe_statement lout;
 	struct qbe_value bout = mklabel(ctx, &lout, ".%d");
 
-	struct gen_value bval;
 	const struct match_case *_default = NULL;
-	for (const struct match_case *_case = expr->match.cases;
+	const struct match_case *cases = expr->match.cases;
+	if (gen_match_tagged_search(ctx, expr, object, &tag,
+			gvout, out, &bout, &_default)) {
+		cases = NULL;
+	}
+	for (const struct match_case *_case = cases;
 			_case; _case = _case->next) {
 		if (!_case->type) {
 			_default = _case;
@@ -2871,55 +4578,13 @@ gen_match_with_tagged(struct gen_context *ctx,
 		}
 
 		push(&ctx->current->body, &lmatch);
-
-		if (!_case->object || _case->type->size == 0) {
-			goto next;
-		}
-
-		struct gen_binding *gb = xcalloc(1, sizeof(struct gen_binding));
-		gb->value = mkgtemp(ctx, _case->type, "binding.%d");
-		gb->object = _case->object;
-		gb->next = ctx->bindings;
-		ctx->bindings = gb;
-
-		struct qbe_value qv = mklval(ctx, &gb->value);
-		enum qbe_instr alloc = alloc_for_align(_case->type->align);
-		struct qbe_value sz = constl(_case->type->size);
-		pushprei(ctx->current, &qv, alloc, &sz, NULL);
-
-		struct qbe_value ptr = mkqtmp(ctx, ctx->arch.ptr, ".%d");
-		struct gen_value src = {
-			.kind = GV_TEMP,
-			.type = _case->type,
-			.name = ptr.name,
-		};
-		struct gen_value load;
-		struct qbe_value offset;
-		switch (compat) {
-		case COMPAT_SUBTYPE:
-			offset = nested_tagged_offset(object.type, _case->type);
-			pushi(ctx->current, &ptr, Q_ADD, &qobject, &offset, NULL);
-			load = gen_load(ctx, src);
-			gen_store(ctx, gb->value, load);
-			break;
-		case COMPAT_SUBSET:
-			pushi(ctx->current, &ptr, Q_COPY, &qobject, NULL);
-			load = gen_load(ctx, src);
-			gen_store(ctx, gb->value, load);
-			break;
-		}
-
-next:
-		bval = gen_expr_with(ctx, _case->value, out);
-		branch_copyresult(ctx, bval, gvout, out);
-		if (_case->value->result->storage != STORAGE_NEVER) {
-			pushi(ctx->current, NULL, Q_JMP, &bout, NULL);
-		}
+		gen_match_case_tagged(ctx, _case, compat, object,
+			gvout, out, &bout);
 		push(&ctx->current->body, &lnext);
 	}
 
 	if (_default) {
-		bval = gen_expr_with(ctx, _default->value, out);
+		struct gen_value bval = gen_expr_with(ctx, _default->value, out);
 		branch_copyresult(ctx, bval, gvout, out);
 	} else {
 		struct qbe_statement labort;
@@ -3039,10 +4704,12 @@ gen_expr_len(struct gen_context *ctx, const struct expression *expr)
 	assert(type != NULL);
 	type = type_dealias(NULL, type);
 	assert(type->storage == STORAGE_SLICE || type->storage == STORAGE_STRING);
-	struct gen_value gv = gen_autoderef(ctx, gen_expr(ctx, value));
 	struct qbe_value len;
-	struct gen_slice sl = gen_slice_ptrs(ctx, gv);
-	load_slice_data(ctx, &sl, NULL, &len, NULL);
+	if (!gen_slice_parts(ctx, value, NULL, &len, NULL)) {
+		struct gen_value gv = gen_autoderef(ctx, gen_expr(ctx, value));
+		struct gen_slice sl = gen_slice_ptrs(ctx, gv);
+		load_slice_data(ctx, &sl, NULL, &len, NULL);
+	}
 	return (struct gen_value){
 		.kind = GV_TEMP,
 		.type = &builtin_type_size,
@@ -3053,72 +4720,458 @@ gen_expr_len(struct gen_context *ctx, const struct expression *expr)
 static struct gen_value
 gen_expr_return(struct gen_context *ctx, const struct expression *expr)
 {
+	struct gen_scope *scope = inline_scope(ctx);
+	if (scope) {
+		// Returns from an inlined function yield its result
+		struct gen_value result = gen_expr_with(ctx,
+			expr->_return.value, scope->out);
+		branch_copyresult(ctx, result, scope->result, scope->out);
+		if (expr->_return.value->result->storage == STORAGE_NEVER) {
+			return gv_void;
+		}
+		gen_defers(ctx, scope);
+		pushi(ctx->current, NULL, Q_JMP, scope->end, NULL);
+		return gv_void;
+	}
+
+	if (ctx->retout) {
+		gen_expr_at(ctx, expr->_return.value, *ctx->retout);
+		if (expr->_return.value->result->storage != STORAGE_NEVER) {
+			gen_defers(ctx, NULL);
+			pushi(ctx->current, NULL, Q_RET, NULL);
+		}
+		return gv_void;
+	}
+
 	struct gen_value ret = gen_expr(ctx, expr->_return.value);
 	if (expr->_return.value->result->storage == STORAGE_NEVER) {
 		return gv_void;
 	}
-	for (struct gen_scope *scope = ctx->scope; scope; scope = scope->parent) {
-		gen_defers(ctx, scope);
-	}
+	gen_defers(ctx, NULL);
 	if (ret.type->size == 0) {
 		pushi(ctx->current, NULL, Q_RET, NULL);
 	} else {
 		struct qbe_value qret = mkqval(ctx, &ret);
 		pushi(ctx->current, NULL, Q_RET, &qret, NULL);
 	}
-	return gv_void;
+	return gv_void;
+}
+
+static void
+gen_expr_struct_at(struct gen_context *ctx,
+	const struct expression *expr,
+	struct gen_value out)
+{
+	// TODO: Merge me into literal expressions
+	struct qbe_value base = mkqval(ctx, &out);
+
+	// Fields which are zero are left to the zero-fill, if any
+	bool zeroed = expr->_struct.autofill;
+	if (!zeroed) {
+		zeroed = true;
+		for (const struct expr_struct_field *field = expr->_struct.fields;
+				field && zeroed; field = field->next) {
+			zeroed = literal_is_zero(field->value);
+		}
+	}
+	if (zeroed) {
+		struct qbe_value base = mklval(ctx, &out);
+		gen_zero_at(ctx, &base, expr->result->size, expr->result->align);
+	}
+
+	struct gen_value ftemp = mkgtemp(ctx, &builtin_type_void, "field.%d");
+	for (const struct expr_struct_field *field = expr->_struct.fields;
+			field; field = field->next) {
+		if (!field->value) {
+			assert(expr->_struct.autofill);
+			continue;
+		}
+		if (zeroed && literal_is_zero(field->value)) {
+			continue;
+		}
+
+		struct qbe_value offs = constl(field->field->offset);
+		ftemp.type = field->value->result;
+		struct qbe_value ptr = mklval(ctx, &ftemp);
+		pushi(ctx->current, &ptr, Q_ADD, &base, &offs, NULL);
+		gen_expr_at(ctx, field->value, ftemp);
+	}
+}
+
+static struct gen_value
+gen_expr_struct(struct gen_context *ctx, const struct expression *expr)
+{
+	if (expr->result->size != 0) {
+		struct gen_value out = mkgtemp(ctx, expr->result, "object.%d");
+		struct qbe_value base = mklval(ctx, &out);
+		struct qbe_value sz = constl(expr->result->size);
+		enum qbe_instr alloc = alloc_for_align(expr->result->align);
+		pushprei(ctx->current, &base, alloc, &sz, NULL);
+		gen_expr_struct_at(ctx, expr, out);
+		return out;
+	}
+
+	for (const struct expr_struct_field *field = expr->_struct.fields;
+			field; field = field->next) {
+		gen_expr(ctx, field->value);
+	}
+	return gv_void;
+}
+
+// Emits the body of each non-default case after its label in lcases
+static void
+gen_switch_bodies(struct gen_context *ctx,
+	const struct expression *expr,
+	struct qbe_statement *lcases,
+	struct gen_value gvout,
+	struct gen_value *out,
+	struct qbe_value *bout)
+{
+	size_t i = 0;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case; _case = _case->next, ++i) {
+		if (!_case->options) {
+			continue;
+		}
+		push(&ctx->current->body, &lcases[i]);
+		struct gen_value bval = gen_expr_with(ctx, _case->value, out);
+		branch_copyresult(ctx, bval, gvout, out);
+		if (_case->value->result->storage != STORAGE_NEVER) {
+			pushi(ctx->current, NULL, Q_JMP, bout, NULL);
+		}
+	}
+}
+
+// Lowers a switch over integers, runes or enums by sorting its case options,
+// collapsing contiguous values which share a case into ranges, and searching
+// the ranges with a balanced binary decision tree. The default case, if any,
+// is left for the caller to generate. Returns false if the switch is better
+// served by a linear chain of comparisons.
+static bool
+gen_switch_ranges(struct gen_context *ctx,
+	const struct expression *expr,
+	struct gen_value value,
+	struct gen_value gvout,
+	struct gen_value *out,
+	struct qbe_value *bout,
+	const struct switch_case **_default)
+{
+	const struct type *type = type_dealias(NULL, value.type);
+	if (type->storage == STORAGE_ENUM) {
+		type = type_dealias(NULL, type->alias.type);
+	}
+	if (!type_is_integer(NULL, type) && type->storage != STORAGE_RUNE) {
+		return false;
+	}
+
+	size_t ncases = 0, nranges = 0;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case; _case = _case->next) {
+		for (struct case_option *opt = _case->options;
+				opt; opt = opt->next) {
+			++nranges;
+		}
+		++ncases;
+	}
+	if (nranges < SWITCH_RANGES_MIN) {
+		return false;
+	}
+
+	struct qbe_statement *lcases = xcalloc(ncases, sizeof(struct qbe_statement));
+	struct qbe_value *bcases = xcalloc(ncases, sizeof(struct qbe_value));
+	struct switch_range *ranges = xcalloc(nranges, sizeof(struct switch_range));
+	size_t i = 0, n = 0;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case; _case = _case->next, ++i) {
+		if (!_case->options) {
+			*_default = _case;
+			continue;
+		}
+		bcases[i] = mklabel(ctx, &lcases[i], "matches.%d");
+		for (struct case_option *opt = _case->options;
+				opt; opt = opt->next) {
+			uint64_t key = switch_range_key(type, opt->value);
+			ranges[n++] = (struct switch_range){
+				.lo = key,
+				.hi = key,
+				._case = i,
+			};
+		}
+	}
+
+	qsort(ranges, nranges, sizeof(struct switch_range), switch_range_compar);
+	n = 0;
+	for (size_t j = 0; j < nranges; ++j) {
+		if (n != 0 && ranges[n - 1]._case == ranges[j]._case
+				&& ranges[n - 1].hi + 1 == ranges[j].lo) {
+			ranges[n - 1].hi = ranges[j].lo;
+			continue;
+		}
+		ranges[n++] = ranges[j];
+	}
+
+	struct qbe_statement ldefault;
+	struct qbe_value bdefault = mklabel(ctx, &ldefault, "default.%d");
+	struct qbe_value qval = extend(ctx, mkqval(ctx, &value), type);
+	gen_switch_search(ctx, type, &qval, ranges, n, bcases, &bdefault);
+	gen_switch_bodies(ctx, expr, lcases, gvout, out, bout);
+	push(&ctx->current->body, &ldefault);
+
+	free(lcases);
+	free(bcases);
+	free(ranges);
+	return true;
+}
+
+struct switch_string {
+	const struct expression *value;
+	size_t _case;
+};
+
+static int
+switch_string_compar(const void *_a, const void *_b)
+{
+	const struct switch_string *a = _a, *b = _b;
+	size_t alen = a->value->literal.string.len;
+	size_t blen = b->value->literal.string.len;
+	if (alen != blen) {
+		return alen < blen ? -1 : 1;
+	}
+	if (alen == 0) {
+		return 0;
+	}
+	return memcmp(a->value->literal.string.value,
+		b->value->literal.string.value, alen);
+}
+
+// Compares the value against each of the candidates in turn, branching to the
+// case of the first equal candidate or to bdefault if there is none
+static void
+gen_switch_strcmp(struct gen_context *ctx, struct gen_value value,
+	const struct switch_string *cands, size_t n,
+	struct qbe_value *bcases, struct qbe_value *bdefault)
+{
+	struct qbe_value qval = mkqval(ctx, &value);
+	struct qbe_value cond = mkqtmp(ctx, &qbe_word, ".%d");
+	for (size_t i = 0; i < n; ++i) {
+		struct qbe_statement lnext;
+		struct qbe_value bnext = *bdefault;
+		if (i + 1 < n) {
+			bnext = mklabel(ctx, &lnext, ".%d");
+		}
+		struct gen_value test = gen_expr_literal(ctx, cands[i].value);
+		struct qbe_value qtest = mkqval(ctx, &test);
+		pushi(ctx->current, &cond, Q_CALL,
+			&ctx->rt.strcmp, &qval, &qtest, NULL);
+		pushi(ctx->current, NULL, Q_JNZ, &cond,
+			&bcases[cands[i]._case], &bnext, NULL);
+		if (i + 1 < n) {
+			push(&ctx->current->body, &lnext);
+		}
+	}
 }
 
+// Dispatches among candidates of equal length on the byte which tells the
+// most of them apart, leaving a full comparison only for candidates which
+// share that byte
 static void
-gen_expr_struct_at(struct gen_context *ctx,
-	const struct expression *expr,
-	struct gen_value out)
+gen_switch_strings_byte(struct gen_context *ctx, struct gen_value value,
+	struct qbe_value *data, const struct switch_string *cands, size_t n,
+	struct qbe_value *bcases, struct qbe_value *bdefault)
 {
-	// TODO: Merge me into literal expressions
-	struct qbe_value base = mkqval(ctx, &out);
+	size_t len = cands[0].value->literal.string.len;
+	if (len == 0) {
+		// Case options are unique, so this is the only candidate
+		assert(n == 1);
+		pushi(ctx->current, NULL, Q_JMP, &bcases[cands[0]._case], NULL);
+		return;
+	}
+	if (n == 1 && len > 1) {
+		gen_switch_strcmp(ctx, value, cands, n, bcases, bdefault);
+		return;
+	}
 
-	if (expr->_struct.autofill) {
-		struct qbe_value size =
-			constl(expr->result->size), zero = constl(0);
-		struct qbe_value base = mklval(ctx, &out);
-		pushi(ctx->current, NULL, Q_CALL, &ctx->rt.memset,
-			&base, &zero, &size, NULL);
+	size_t pos = 0, best = 0;
+	for (size_t i = 0; i < len && best < n; ++i) {
+		bool seen[256] = {0};
+		size_t distinct = 0;
+		for (size_t j = 0; j < n; ++j) {
+			unsigned char c = cands[j].value->literal.string.value[i];
+			if (!seen[c]) {
+				seen[c] = true;
+				++distinct;
+			}
+		}
+		if (distinct > best) {
+			pos = i, best = distinct;
+		}
 	}
 
-	struct gen_value ftemp = mkgtemp(ctx, &builtin_type_void, "field.%d");
-	for (const struct expr_struct_field *field = expr->_struct.fields;
-			field; field = field->next) {
-		if (!field->value) {
-			assert(expr->_struct.autofill);
+	struct switch_range *bytes = xcalloc(n, sizeof(struct switch_range));
+	for (size_t j = 0; j < n; ++j) {
+		unsigned char c = cands[j].value->literal.string.value[pos];
+		bytes[j] = (struct switch_range){
+			.lo = c,
+			.hi = c,
+			._case = j,
+		};
+	}
+	qsort(bytes, n, sizeof(struct switch_range), switch_range_compar);
+
+	struct switch_range *groups = xcalloc(best, sizeof(struct switch_range));
+	struct qbe_statement *lgroups = xcalloc(best, sizeof(struct qbe_statement));
+	struct qbe_value *bgroups = xcalloc(best, sizeof(struct qbe_value));
+	size_t ngroups = 0;
+	for (size_t j = 0; j < n; ++j) {
+		if (j != 0 && bytes[j - 1].lo == bytes[j].lo) {
 			continue;
 		}
+		groups[ngroups] = (struct switch_range){
+			.lo = bytes[j].lo,
+			.hi = bytes[j].lo,
+			._case = ngroups,
+		};
+		bgroups[ngroups] = mklabel(ctx, &lgroups[ngroups], ".%d");
+		++ngroups;
+	}
+	assert(ngroups == best);
 
-		struct qbe_value offs = constl(field->field->offset);
-		ftemp.type = field->value->result;
-		struct qbe_value ptr = mklval(ctx, &ftemp);
-		pushi(ctx->current, &ptr, Q_ADD, &base, &offs, NULL);
-		gen_expr_at(ctx, field->value, ftemp);
+	struct qbe_value ptr = mkqtmp(ctx, ctx->arch.ptr, ".%d");
+	struct qbe_value byte = mkqtmp(ctx, &qbe_word, ".%d");
+	struct qbe_value offs = constl(pos);
+	pushi(ctx->current, &ptr, Q_ADD, data, &offs, NULL);
+	pushi(ctx->current, &byte, Q_LOADUB, &ptr, NULL);
+	gen_switch_search(ctx, &builtin_type_u8, &byte, groups, ngroups,
+		bgroups, bdefault);
+
+	struct switch_string *sub = xcalloc(n, sizeof(struct switch_string));
+	for (size_t j = 0, g = 0; j < n; ++g) {
+		size_t k = 0;
+		for (; j < n && bytes[j].lo == groups[g].lo; ++j) {
+			sub[k++] = cands[bytes[j]._case];
+		}
+		push(&ctx->current->body, &lgroups[g]);
+		if (len == 1) {
+			assert(k == 1);
+			pushi(ctx->current, NULL, Q_JMP,
+				&bcases[sub[0]._case], NULL);
+		} else {
+			gen_switch_strcmp(ctx, value, sub, k, bcases, bdefault);
+		}
 	}
+
+	free(sub);
+	free(bgroups);
+	free(lgroups);
+	free(groups);
+	free(bytes);
 }
 
-static struct gen_value
-gen_expr_struct(struct gen_context *ctx, const struct expression *expr)
+// Lowers a switch over strings into a binary search on the length of the
+// value, then a search on a single byte among the options of that length, so
+// that at most a few full comparisons are made per lookup. The default case,
+// if any, is left for the caller to generate. Returns false if the switch is
+// better served by a linear chain of comparisons.
+static bool
+gen_switch_strings(struct gen_context *ctx,
+	const struct expression *expr,
+	struct gen_value value,
+	struct gen_value gvout,
+	struct gen_value *out,
+	struct qbe_value *bout,
+	const struct switch_case **_default)
 {
-	if (expr->result->size != 0) {
-		struct gen_value out = mkgtemp(ctx, expr->result, "object.%d");
-		struct qbe_value base = mklval(ctx, &out);
-		struct qbe_value sz = constl(expr->result->size);
-		enum qbe_instr alloc = alloc_for_align(expr->result->align);
-		pushprei(ctx->current, &base, alloc, &sz, NULL);
-		gen_expr_struct_at(ctx, expr, out);
-		return out;
+	const struct type *type = type_dealias(NULL, value.type);
+	if (type->storage != STORAGE_STRING) {
+		return false;
 	}
 
-	for (const struct expr_struct_field *field = expr->_struct.fields;
-			field; field = field->next) {
-		gen_expr(ctx, field->value);
+	size_t ncases = 0, nstrings = 0;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case; _case = _case->next) {
+		for (struct case_option *opt = _case->options;
+				opt; opt = opt->next) {
+			++nstrings;
+		}
+		++ncases;
 	}
-	return gv_void;
+	if (nstrings < SWITCH_RANGES_MIN) {
+		return false;
+	}
+
+	struct qbe_statement *lcases = xcalloc(ncases, sizeof(struct qbe_statement));
+	struct qbe_value *bcases = xcalloc(ncases, sizeof(struct qbe_value));
+	struct switch_string *strings =
+		xcalloc(nstrings, sizeof(struct switch_string));
+	size_t i = 0, n = 0;
+	for (const struct switch_case *_case = expr->_switch.cases;
+			_case; _case = _case->next, ++i) {
+		if (!_case->options) {
+			*_default = _case;
+			continue;
+		}
+		bcases[i] = mklabel(ctx, &lcases[i], "matches.%d");
+		for (struct case_option *opt = _case->options;
+				opt; opt = opt->next) {
+			assert(opt->value->type == EXPR_LITERAL);
+			strings[n++] = (struct switch_string){
+				.value = opt->value,
+				._case = i,
+			};
+		}
+	}
+	qsort(strings, nstrings, sizeof(struct switch_string),
+		switch_string_compar);
+
+	// One range per distinct length, each leading to the options of that
+	// length
+	struct switch_range *lens = xcalloc(nstrings, sizeof(struct switch_range));
+	struct qbe_statement *llens = xcalloc(nstrings, sizeof(struct qbe_statement));
+	struct qbe_value *blens = xcalloc(nstrings, sizeof(struct qbe_value));
+	size_t nlens = 0;
+	for (size_t j = 0; j < nstrings; ++j) {
+		size_t len = strings[j].value->literal.string.len;
+		if (nlens != 0 && lens[nlens - 1].lo == len) {
+			continue;
+		}
+		lens[nlens] = (struct switch_range){
+			.lo = len,
+			.hi = len,
+			._case = nlens,
+		};
+		blens[nlens] = mklabel(ctx, &llens[nlens], ".%d");
+		++nlens;
+	}
+
+	struct qbe_statement ldefault;
+	struct qbe_value bdefault = mklabel(ctx, &ldefault, "default.%d");
+	struct qbe_value data, len;
+	struct gen_slice sl = gen_slice_ptrs(ctx, value);
+	load_slice_data(ctx, &sl, &data, &len, NULL);
+	gen_switch_search(ctx, &builtin_type_size, &len, lens, nlens,
+		blens, &bdefault);
+
+	for (size_t j = 0, l = 0; l < nlens; ++l) {
+		size_t start = j;
+		while (j < nstrings
+				&& strings[j].value->literal.string.len == lens[l].lo) {
+			++j;
+		}
+		push(&ctx->current->body, &llens[l]);
+		gen_switch_strings_byte(ctx, value, &data, &strings[start],
+			j - start, bcases, &bdefault);
+	}
+
+	gen_switch_bodies(ctx, expr, lcases, gvout, out, bout);
+	push(&ctx->current->body, &ldefault);
+
+	free(blens);
+	free(llens);
+	free(lens);
+	free(strings);
+	free(bcases);
+	free(lcases);
+	return true;
 }
 
 static struct gen_value
@@ -3137,7 +5190,13 @@ gen_expr_switch_with(struct gen_context *ctx,
 
 	struct gen_value bval;
 	const struct switch_case *_default = NULL;
-	for (const struct switch_case *_case = expr->_switch.cases;
+	const struct switch_case *cases = expr->_switch.cases;
+	if (gen_switch_ranges(ctx, expr, value, gvout, out, &bout, &_default)
+			|| gen_switch_strings(ctx, expr, value,
+				gvout, out, &bout, &_default)) {
+		cases = NULL;
+	}
+	for (const struct switch_case *_case = cases;
 			_case; _case = _case->next) {
 		if (!_case->options) {
 			_default = _case;
@@ -3209,22 +5268,26 @@ gen_expr_slice_at(struct gen_context *ctx,
 	const struct expression *expr,
 	struct gen_value out)
 {
-	struct gen_value object = gen_expr(ctx, expr->slice.object);
-	object = gen_autoderef(ctx, object);
-	const struct type *srctype = type_dealias(NULL, object.type);
-
 	struct qbe_value qbase, qstart, qnewlen, qnewcap;
 	struct qbe_value qlen_, qcap_, *qlen = &qlen_, *qcap = &qcap_;
-	if (srctype->storage == STORAGE_ARRAY) {
-		qbase = mkcopy(ctx, &object, ".%d");
-		if (srctype->array.length == SIZE_UNDEFINED) {
-			qcap = qlen = NULL;
+	const struct type *srctype;
+	if (gen_slice_parts(ctx, expr->slice.object, &qbase, qlen, qcap)) {
+		srctype = type_dealias(NULL, expr->slice.object->result);
+	} else {
+		struct gen_value object = gen_expr(ctx, expr->slice.object);
+		object = gen_autoderef(ctx, object);
+		srctype = type_dealias(NULL, object.type);
+		if (srctype->storage == STORAGE_ARRAY) {
+			qbase = mkcopy(ctx, &object, ".%d");
+			if (srctype->array.length == SIZE_UNDEFINED) {
+				qcap = qlen = NULL;
+			} else {
+				*qcap = *qlen = constl(srctype->array.length);
+			}
 		} else {
-			*qcap = *qlen = constl(srctype->array.length);
+			struct gen_slice sl = gen_slice_ptrs(ctx, object);
+			load_slice_data(ctx, &sl, &qbase, qlen, qcap);
 		}
-	} else {
-		struct gen_slice sl = gen_slice_ptrs(ctx, object);
-		load_slice_data(ctx, &sl, &qbase, qlen, qcap);
 	}
 	gen_subslice_info(ctx, expr, qlen, qcap, &qstart, NULL, &qnewlen, &qnewcap);
 
@@ -3400,7 +5463,7 @@ gen_expr(struct gen_context *ctx, const struct expression *expr)
 		out = gen_expr_control(ctx, expr);
 		break;
 	case EXPR_CALL:
-		out = gen_expr_call(ctx, expr);
+		out = gen_expr_call_with(ctx, expr, NULL);
 		break;
 	case EXPR_CAST:
 		out = gen_expr_cast(ctx, expr);
@@ -3493,6 +5556,9 @@ gen_expr_at(struct gen_context *ctx,
 	case EXPR_ALLOC:
 		gen_expr_alloc_with(ctx, expr, &out);
 		return;
+	case EXPR_CALL:
+		gen_expr_call_with(ctx, expr, &out);
+		return;
 	case EXPR_CAST:
 		gen_expr_cast_at(ctx, expr, out);
 		return;
@@ -3567,8 +5633,11 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 	mklabel(ctx, &start_label, "start.%d");
 	push(&qdef->func.prelude, &start_label);
 
+	const struct gen_local *local = local_lookup_decl(ctx, decl);
+	bool placed = local && local->placed;
 	if (fntype->func.result->size != 0
-			&& fntype->func.result->size != SIZE_UNDEFINED) {
+			&& fntype->func.result->size != SIZE_UNDEFINED
+			&& !placed) {
 		qdef->func.returns = qtype_lookup(
 			ctx, fntype->func.result, false);
 	} else {
@@ -3579,6 +5648,18 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 	}
 
 	struct qbe_func_param *param, **next = &qdef->func.params;
+	struct gen_value retout = {
+		.kind = GV_TEMP,
+		.type = fntype->func.result,
+	};
+	if (placed) {
+		param = *next = xcalloc(1, sizeof(struct qbe_func_param));
+		param->name = gen_name(&ctx->id, "out.%d");
+		param->type = ctx->arch.ptr;
+		retout.name = param->name;
+		ctx->retout = &retout;
+		next = &param->next;
+	}
 	for (struct scope_object *obj = decl->func.scope->objects;
 			obj; obj = obj->lnext) {
 		const struct type *type = obj->type;
@@ -3588,7 +5669,11 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 		param = *next = xcalloc(1, sizeof(struct qbe_func_param));
 		assert(!obj->ident.ns); // Invariant
 		param->name = xstrdup(obj->ident.name);
-		param->type = qtype_lookup(ctx, type, false);
+		if (local && param_forwarded(obj)) {
+			param->type = ctx->arch.ptr;
+		} else {
+			param->type = qtype_lookup(ctx, type, false);
+		}
 
 		struct gen_binding *gb =
 			xcalloc(1, sizeof(struct gen_binding));
@@ -3598,6 +5683,16 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 		if (type_is_aggregate(type)) {
 			// No need to copy to stack
 			gb->value.name = xstrdup(param->name);
+			gen_binding_parts(ctx, gb);
+		} else if (binding_in_reg(obj)) {
+			gb->value.name = gen_name(&ctx->id, "param.%d");
+			gb->reg = true;
+			struct gen_value src = {
+				.kind = GV_TEMP,
+				.type = type,
+				.name = param->name,
+			};
+			gen_binding_store(ctx, gb, src);
 		} else {
 			gb->value.name = gen_name(&ctx->id, "param.%d");
 
@@ -3618,10 +5713,13 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 		next = &param->next;
 	}
 
+	escape_expr(ctx, decl->func.body);
+
 	struct qbe_statement lbody;
 	mklabel(ctx, &lbody, "body.%d");
 	push(&ctx->current->body, &lbody);
-	struct gen_value ret = gen_expr(ctx, decl->func.body);
+	struct gen_value ret = gen_expr_with(ctx, decl->func.body,
+		placed ? &retout : NULL);
 
 	if (fntype->func.result->storage == STORAGE_NEVER) {
 		pushi(ctx->current, NULL, Q_HLT, NULL);
@@ -3632,12 +5730,29 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 		if (last->type != Q_INSTR || last->instr != Q_RET) {
 			pushi(ctx->current, NULL, Q_RET, NULL);
 		}
-	} else if (fntype->func.result->size != 0) {
+	} else if (fntype->func.result->size != 0 && !placed) {
 		struct qbe_value qret = mkqval(ctx, &ret);
 		pushi(ctx->current, NULL, Q_RET, &qret, NULL);
 	} else {
 		pushi(ctx->current, NULL, Q_RET, NULL);
 	}
+	ctx->retout = NULL;
+	for (size_t i = 0; i < ctx->cold.ln; ++i) {
+		push(&ctx->current->body, &ctx->cold.stmts[i]);
+	}
+	ctx->cold.ln = 0;
+	for (struct gen_abort *site = ctx->aborts; site; /* n/a */) {
+		struct gen_abort *next = site->next;
+		free(site);
+		site = next;
+	}
+	ctx->aborts = NULL;
+	for (struct gen_stackalloc *sa = ctx->stackallocs; sa; /* n/a */) {
+		struct gen_stackalloc *next = sa->next;
+		free(sa);
+		sa = next;
+	}
+	ctx->stackallocs = NULL;
 
 	qbe_append_def(ctx->out, qdef);
 
@@ -3726,6 +5841,184 @@ gen_function_decl(struct gen_context *ctx, const struct declaration *decl)
 	ctx->current = NULL;
 }
 
+static bool
+data_is_packable(const struct type *type)
+{
+	type = type_dealias(NULL, type);
+	if (type->storage == STORAGE_ENUM) {
+		type = type->alias.type;
+	}
+	switch (type->storage) {
+	case STORAGE_BOOL:
+	case STORAGE_F32:
+	case STORAGE_F64:
+	case STORAGE_I8:
+	case STORAGE_I16:
+	case STORAGE_I32:
+	case STORAGE_I64:
+	case STORAGE_INT:
+	case STORAGE_RUNE:
+	case STORAGE_SIZE:
+	case STORAGE_U8:
+	case STORAGE_U16:
+	case STORAGE_U32:
+	case STORAGE_U64:
+	case STORAGE_UINT:
+		return true;
+	case STORAGE_ARRAY:
+		return type->array.length != SIZE_UNDEFINED
+			&& data_is_packable(type->array.members);
+	default:
+		// Pointers and uintptrs may refer to symbols, which can only be
+		// resolved by the linker
+		return false;
+	}
+}
+
+static void gen_data_pack_array(const struct array_literal *array, size_t n,
+	const struct type *members, unsigned char *buf);
+
+static void
+gen_data_pack(const struct expression *expr, unsigned char *buf)
+{
+	assert(expr->type == EXPR_LITERAL);
+	const struct expression_literal *literal = &expr->literal;
+	assert(!literal->object);
+	const struct type *type = type_dealias(NULL, expr->result);
+	if (type->storage == STORAGE_ENUM) {
+		type = type->alias.type;
+	}
+	type = lower_flexible(NULL, type, NULL);
+
+	uint64_t val;
+	switch (type->storage) {
+	case STORAGE_ARRAY:
+		gen_data_pack_array(literal->array, type->array.length,
+			type->array.members, buf);
+		return;
+	case STORAGE_BOOL:
+		val = literal->bval ? 1 : 0;
+		break;
+	case STORAGE_F32:;
+		float f = (float)literal->fval;
+		uint32_t fbits;
+		memcpy(&fbits, &f, sizeof(fbits));
+		val = fbits;
+		break;
+	case STORAGE_F64:;
+		double d = (double)literal->fval;
+		memcpy(&val, &d, sizeof(val));
+		break;
+	default:
+		val = literal->uval;
+		break;
+	}
+
+	// All supported targets are little-endian
+	for (size_t i = 0; i < type->size; ++i) {
+		buf[i] = (unsigned char)(val >> (i * 8));
+	}
+}
+
+static void
+gen_data_pack_array(const struct array_literal *array, size_t n,
+	const struct type *members, unsigned char *buf)
+{
+	for (const struct array_literal *c = array; c && n; c = c->next) {
+		size_t run = array_literal_run(c, n);
+		gen_data_pack(c->value, buf);
+		for (size_t i = 1; i < run; ++i) {
+			memcpy(buf + i * members->size, buf, members->size);
+		}
+		buf += run * members->size;
+		n -= run;
+	}
+}
+
+struct data_blob {
+	struct qbe_data_item *item;
+	bool used;
+	unsigned char *buf;
+	size_t ln, sz;
+	size_t zeroed;
+};
+
+static struct qbe_data_item *
+data_blob_item(struct data_blob *blob)
+{
+	if (blob->used) {
+		blob->item->next = xcalloc(1, sizeof(struct qbe_data_item));
+		blob->item = blob->item->next;
+	}
+	blob->used = true;
+	return blob->item;
+}
+
+static void
+data_blob_flush(struct data_blob *blob)
+{
+	if (blob->ln != 0) {
+		struct qbe_data_item *item = data_blob_item(blob);
+		item->type = QD_STRING;
+		item->str = (char *)blob->buf;
+		item->sz = blob->ln;
+		blob->buf = NULL;
+		blob->ln = blob->sz = 0;
+	}
+	if (blob->zeroed != 0) {
+		struct qbe_data_item *item = data_blob_item(blob);
+		item->type = QD_ZEROED;
+		item->zeroed = blob->zeroed;
+		blob->zeroed = 0;
+	}
+}
+
+// Serializes an array of packable values into byte blobs, rather than
+// emitting one data item per element. Zero-valued elements are emitted as
+// zeroed items, so runs of zeroes take no space in the compiler or the IR.
+static struct qbe_data_item *
+gen_data_packed(struct qbe_data_item *item, const struct array_literal *array,
+	size_t n, const struct type *members)
+{
+	size_t msize = members->size;
+	unsigned char *elem = xcalloc(1, msize);
+	struct data_blob blob = { .item = item };
+	for (const struct array_literal *c = array; c && n; c = c->next) {
+		size_t run = array_literal_run(c, n);
+		n -= run;
+
+		memset(elem, 0, msize);
+		gen_data_pack(c->value, elem);
+		bool zero = true;
+		for (size_t i = 0; i < msize && zero; ++i) {
+			zero = elem[i] == 0;
+		}
+		if (zero) {
+			if (blob.ln != 0) {
+				data_blob_flush(&blob);
+			}
+			blob.zeroed += run * msize;
+			continue;
+		}
+
+		if (blob.zeroed != 0) {
+			data_blob_flush(&blob);
+		}
+		if (blob.ln + run * msize > blob.sz) {
+			blob.sz = blob.sz * 2 > blob.ln + run * msize
+				? blob.sz * 2 : blob.ln + run * msize;
+			blob.buf = xrealloc(blob.buf, blob.sz);
+		}
+		for (size_t i = 0; i < run; ++i) {
+			memcpy(blob.buf + blob.ln, elem, msize);
+			blob.ln += msize;
+		}
+	}
+	data_blob_flush(&blob);
+	free(elem);
+	return blob.item;
+}
+
 static struct qbe_data_item *
 gen_data_item(struct gen_context *ctx, const struct expression *expr,
 	struct qbe_data_item *item)
@@ -3799,10 +6092,40 @@ gen_data_item(struct gen_context *ctx, const struct expression *expr,
 	case STORAGE_ARRAY:
 		assert(type->array.length != SIZE_UNDEFINED);
 		size_t n = type->array.length;
+		if (type->size != 0 && data_is_packable(type->array.members)) {
+			item = gen_data_packed(item, literal->array, n,
+				type->array.members);
+			break;
+		}
 		for (struct array_literal *c = literal->array;
-				c && n; c = c->next ? c->next : c, --n) {
+				c && n; c = c->next) {
+			size_t run = array_literal_run(c, n);
+			n -= run;
+			struct qbe_data_item *first = item;
 			item = gen_data_item(ctx, c->value, item);
-			if (n > 1 || c->next) {
+			if (run > 1 && type->array.members->size != 0
+					&& qbe_data_is_zeroes(first)) {
+				first->type = QD_ZEROED;
+				first->zeroed = run * type->array.members->size;
+				first->next = NULL;
+				item = first;
+			} else {
+				struct qbe_data_item *last = item;
+				for (size_t i = 1; i < run; ++i) {
+					for (struct qbe_data_item *it = first;
+							it; it = it->next) {
+						item->next = xcalloc(1,
+							sizeof(struct qbe_data_item));
+						item = item->next;
+						*item = *it;
+						item->next = NULL;
+						if (it == last) {
+							break;
+						}
+					}
+				}
+			}
+			if (n > 0) {
 				item->next = xcalloc(1,
 					sizeof(struct qbe_data_item));
 				item = item->next;
@@ -3847,16 +6170,29 @@ gen_data_item(struct gen_context *ctx, const struct expression *expr,
 		def->data.align = ALIGN_UNDEFINED;
 
 		size_t len = 0;
-		struct qbe_data_item *subitem = &def->data.items;
 		for (struct array_literal *c = literal->array;
 				c; c = c->next) {
-			subitem = gen_data_item(ctx, c->value, subitem);
-			if (c->next) {
-				subitem->next = xcalloc(1,
-					sizeof(struct qbe_data_item));
-				subitem = subitem->next;
+			len += c->repeat + 1;
+		}
+
+		struct qbe_data_item *subitem = &def->data.items;
+		if (len != 0 && type->array.members->size != 0
+				&& data_is_packable(type->array.members)) {
+			gen_data_packed(subitem, literal->array, len,
+				type->array.members);
+		} else {
+			for (struct array_literal *c = literal->array;
+					c; c = c->next) {
+				for (size_t i = 0; i <= c->repeat; ++i) {
+					subitem = gen_data_item(ctx,
+						c->value, subitem);
+					if (c->next || i < c->repeat) {
+						subitem->next = xcalloc(1,
+							sizeof(struct qbe_data_item));
+						subitem = subitem->next;
+					}
+				}
 			}
-			++len;
 		}
 
 		item->type = QD_VALUE;
@@ -4036,6 +6372,141 @@ gen_decl(struct gen_context *ctx, const struct declaration *decl)
 	}
 }
 
+// Functions and globals are only generated if they are visible outside of the
+// unit, or something generated refers to them
+struct reach_decl {
+	const struct declaration *decl;
+	// Referenced other than as the callee of a call
+	bool live, escapes;
+	struct reach_decl *next;
+};
+
+struct reach_state {
+	struct reach_decl **buckets;
+	size_t nbuckets;
+	const struct declaration **work;
+	size_t nwork;
+};
+
+static void
+reach_object(struct reach_state *state,
+	const struct scope_object *obj,
+	bool escapes)
+{
+	char *sym = ident_to_sym(&obj->ident);
+	uint32_t hash = fnv1a_s(FNV1A_INIT, sym);
+	for (struct reach_decl *rd = state->buckets[hash % state->nbuckets];
+			rd; rd = rd->next) {
+		if (strcmp(rd->decl->symbol, sym) != 0) {
+			continue;
+		}
+		// A prototype given the symbol of another declaration with
+		// @symbol refers to that declaration as well
+		rd->escapes |= escapes;
+		if (!rd->live) {
+			rd->live = true;
+			state->work[state->nwork++] = rd->decl;
+		}
+	}
+	free(sym);
+}
+
+static void
+reach_visit(const struct expression *expr, void *user)
+{
+	struct reach_state *state = user;
+	const struct expression *lvalue = expr->type == EXPR_CALL
+		? expr->call.lvalue : NULL;
+	if (lvalue && lvalue->type == EXPR_ACCESS
+			&& lvalue->access.type == ACCESS_IDENTIFIER
+			&& lvalue->access.object->otype == O_DECL) {
+		reach_object(state, lvalue->access.object, false);
+		for (const struct call_argument *arg = expr->call.args;
+				arg; arg = arg->next) {
+			reach_visit(arg->value, user);
+		}
+		return;
+	}
+	if (expr->type == EXPR_ACCESS
+			&& expr->access.type == ACCESS_IDENTIFIER
+			&& expr->access.object->otype == O_DECL) {
+		reach_object(state, expr->access.object, true);
+	} else if (expr->type == EXPR_LITERAL && expr->literal.object) {
+		reach_object(state, expr->literal.object, true);
+	}
+	expr_children(expr, reach_visit, user);
+}
+
+static bool
+reach_root(const struct declaration *decl)
+{
+	if (decl->exported) {
+		return true;
+	}
+	if (decl->decl_type == DECL_FUNC && decl->func.flags != 0) {
+		return true; // @init, @fini, @test
+	}
+	// A symbol other than the one derived from the identifier was
+	// given with @symbol
+	char *sym = ident_to_sym(&decl->ident);
+	bool explicit = strcmp(sym, decl->symbol) != 0;
+	free(sym);
+	return explicit;
+}
+
+// Finds, for each declaration of the unit in order, whether it is generated,
+// and whether anything but a call refers to it
+static void
+reach(const struct unit *unit, bool *live, bool *escapes)
+{
+	size_t ndecls = 0;
+	for (const struct declarations *d = unit->declarations; d; d = d->next) {
+		++ndecls;
+	}
+
+	struct reach_state state = {
+		.nbuckets = ndecls * 2 + 1,
+	};
+	state.buckets = xcalloc(state.nbuckets, sizeof(struct reach_decl *));
+	state.work = xcalloc(ndecls, sizeof(const struct declaration *));
+	struct reach_decl *rds = xcalloc(ndecls, sizeof(struct reach_decl));
+	size_t i = 0;
+	for (const struct declarations *d = unit->declarations;
+			d; d = d->next, ++i) {
+		const struct declaration *decl = &d->decl;
+		rds[i].decl = decl;
+		if (decl->decl_type != DECL_FUNC
+				&& decl->decl_type != DECL_GLOBAL) {
+			rds[i].live = true;
+			continue;
+		}
+		uint32_t hash = fnv1a_s(FNV1A_INIT, decl->symbol);
+		rds[i].next = state.buckets[hash % state.nbuckets];
+		state.buckets[hash % state.nbuckets] = &rds[i];
+		if (reach_root(decl)) {
+			rds[i].live = rds[i].escapes = true;
+			state.work[state.nwork++] = decl;
+		}
+	}
+
+	while (state.nwork != 0) {
+		const struct declaration *decl = state.work[--state.nwork];
+		if (decl->decl_type == DECL_FUNC && decl->func.body) {
+			reach_visit(decl->func.body, &state);
+		} else if (decl->decl_type == DECL_GLOBAL && decl->global.value) {
+			reach_visit(decl->global.value, &state);
+		}
+	}
+
+	for (i = 0; i < ndecls; ++i) {
+		live[i] = rds[i].live;
+		escapes[i] = rds[i].escapes;
+	}
+	free(rds);
+	free(state.work);
+	free(state.buckets);
+}
+
 void
 gen(const struct unit *unit, type_store *store, struct qbe_program *out)
 {
@@ -4058,9 +6529,41 @@ gen(const struct unit *unit, type_store *store, struct qbe_program *out)
 		ctx.sources[i] = gen_literal_string(&ctx, &eloc);
 	}
 
-	const struct declarations *decls = unit->declarations;
-	while (decls) {
-		gen_decl(&ctx, &decls->decl);
-		decls = decls->next;
+	size_t ndecls = 0;
+	const struct declarations *decls;
+	for (decls = unit->declarations; decls; decls = decls->next) {
+		++ndecls;
+	}
+	bool *live = xcalloc(ndecls, sizeof(bool));
+	bool *escapes = xcalloc(ndecls, sizeof(bool));
+	reach(unit, live, escapes);
+
+	size_t i = 0;
+	for (decls = unit->declarations; decls; decls = decls->next, ++i) {
+		if (!live[i]) {
+			continue;
+		}
+		if (inlinable(&decls->decl)) {
+			struct gen_inline *il = xcalloc(1, sizeof(struct gen_inline));
+			il->decl = &decls->decl;
+			il->next = ctx.inlines;
+			ctx.inlines = il;
+		}
+		if (!escapes[i] && local_callable(&decls->decl)) {
+			struct gen_local *lc = xcalloc(1, sizeof(struct gen_local));
+			lc->decl = &decls->decl;
+			lc->placed = placeable(&decls->decl);
+			lc->next = ctx.locals;
+			ctx.locals = lc;
+		}
+	}
+
+	decls = unit->declarations;
+	for (i = 0; decls; decls = decls->next, ++i) {
+		if (live[i]) {
+			gen_decl(&ctx, &decls->decl);
+		}
 	}
+	free(live);
+	free(escapes);
 }
@@ -12,6 +12,7 @@
 #include "lex.h"
 #include "parse.h"
 #include "qbe.h"
+#include "qopt.h"
 #include "type_store.h"
 #include "typedef.h"
 #include "util.h"
@@ -20,7 +21,7 @@ static void
 usage(const char *argv_0)
 {
 	xfprintf(stderr,
-		"Usage: %s [-a arch] [-D ident[:type]=value] [-M path] [-m symbol] [-N namespace] [-o output] [-T] [-t typedefs] [-v] input.ha...\n\n",
+		"Usage: %s [-a arch] [-D ident[:type]=value] [-M path] [-m symbol] [-N namespace] [-O] [-o output] [-s] [-T] [-t typedefs] [-v] input.ha...\n\n",
 		argv_0);
 	xfprintf(stderr,
 		"-a: set target architecture\n"
@@ -29,7 +30,9 @@ usage(const char *argv_0)
 		"-M: set module path prefix, to be stripped from error messages\n"
 		"-m: set symbol of hosted main function\n"
 		"-N: override namespace for module\n"
+		"-O: optimize the generated IR\n"
 		"-o: set output file name\n"
+		"-s: print IR statistics\n"
 		"-T: emit tests\n"
 		"-t: emit typedefs to file\n"
 		"-v: print version and exit\n");
@@ -76,13 +79,13 @@ main(int argc, char *argv[])
 	const char *target = DEFAULT_TARGET;
 	const char *modpath = NULL;
 	const char *mainsym = "main";
-	bool is_test = false;
+	bool is_test = false, optimize = false, stats = false;
 	struct unit unit = {0};
 	struct lexer lexer;
 	struct ast_global_decl *defines = NULL, **next_def = &defines;
 
 	int c;
-	while ((c = getopt(argc, argv, "a:D:hM:m:N:o:Tt:v")) != -1) {
+	while ((c = getopt(argc, argv, "a:D:hM:m:N:Oo:sTt:v")) != -1) {
 		switch (c) {
 		case 'a':
 			target = optarg;
@@ -118,9 +121,15 @@ main(int argc, char *argv[])
 				lex_finish(&lexer);
 			}
 			break;
+		case 'O':
+			optimize = true;
+			break;
 		case 'o':
 			output = optarg;
 			break;
+		case 's':
+			stats = true;
+			break;
 		case 'T':
 			is_test = true;
 			break;
@@ -211,6 +220,19 @@ main(int argc, char *argv[])
 	struct qbe_program prog = {0};
 	gen(&unit, &ts, &prog);
 
+	struct qopt_stats before, after;
+	if (stats) {
+		qopt_stats(&prog, &before);
+		qopt_print_stats(&before, optimize ? "before" : "ir", stderr);
+	}
+	if (optimize) {
+		qopt(&prog);
+		if (stats) {
+			qopt_stats(&prog, &after);
+			qopt_print_stats(&after, "after", stderr);
+		}
+	}
+
 	FILE *out;
 	if (!output) {
 		out = stdout;
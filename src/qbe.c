@@ -146,6 +146,48 @@ qbe_append_def(struct qbe_program *prog, struct qbe_def *def)
 	prog->next = &def->next;
 }
 
+bool
+qbe_data_is_zeroes(const struct qbe_data_item *data)
+{
+	for (const struct qbe_data_item *cur = data; cur; cur = cur->next) {
+		switch (cur->type) {
+		case QD_ZEROED:
+			break;
+		case QD_VALUE:
+			switch (cur->value.kind) {
+			case QV_CONST:
+				if (cur->value.type->size < sizeof(uint64_t)) {
+					if (cur->value.wval != 0) {
+						return false;
+					}
+				} else {
+					if (cur->value.lval != 0) {
+						return false;
+					}
+				}
+				break;
+			case QV_GLOBAL:
+			case QV_LABEL:
+			case QV_TEMPORARY:
+				return false;
+			case QV_VARIADIC:
+				abort();
+			}
+			break;
+		case QD_STRING:
+			for (size_t i = 0; i < cur->sz; ++i) {
+				if (cur->str[i] != 0) {
+					return false;
+				}
+			}
+			break;
+		case QD_SYMOFFS:
+			return false;
+		}
+	}
+	return true;
+}
+
 static struct qbe_value *
 qval_dup(const struct qbe_value *val)
 {
@@ -0,0 +1,884 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "qbe.h"
+#include "qopt.h"
+#include "util.h"
+
+// A small cleanup pass over the generated IR, run per function between gen
+// and emit. Within each basic block it propagates copies and forwards stored
+// and loaded values to later loads of the same address; across the function
+// it propagates copies of temporaries which are only defined once, drops
+// arithmetic identities and redundant extensions, and finally removes the
+// definitions of temporaries which are never used.
+
+#define TEMP_BUCKETS 1024
+// Most facts a block keeps about its temporaries and memory at once
+#define BLOCK_MAX 64
+
+struct qopt_temp {
+	const char *name;
+	// Class of the temporary's value: w, l, s or d
+	enum qbe_stype class;
+	size_t defs, uses;
+	// The statement which defines the temporary, if it is defined once
+	struct qbe_statement *def;
+	// Defined by an alloc in the prelude, so its address is distinct
+	// from that of any other alloc
+	bool alloc;
+	struct qopt_temp *next;
+};
+
+struct qopt_func {
+	struct qopt_temp *buckets[TEMP_BUCKETS];
+	size_t ntemps;
+};
+
+// %name holds value since it was copied from it in this block
+struct qopt_copy {
+	const char *name;
+	struct qbe_value value;
+};
+
+// The memory at addr holds value since it was stored or loaded by instr in
+// this block
+struct qopt_mem {
+	struct qbe_value addr, value;
+	enum qbe_instr instr;
+	enum qbe_stype class;
+};
+
+struct qopt_block {
+	struct qopt_copy copies[BLOCK_MAX];
+	size_t ncopies;
+	struct qopt_mem mems[BLOCK_MAX];
+	size_t nmems;
+};
+
+static enum qbe_stype
+qclass(const struct qbe_type *type)
+{
+	switch (type->stype) {
+	case Q_BYTE:
+	case Q_HALF:
+	case Q_WORD:
+		return Q_WORD;
+	case Q_LONG:
+	case Q__AGGREGATE:
+	case Q__UNION:
+		return Q_LONG;
+	case Q_SINGLE:
+	case Q_DOUBLE:
+	case Q__VOID:
+		return type->stype;
+	}
+	abort(); // Unreachable
+}
+
+static struct qopt_temp *
+temp_lookup(struct qopt_func *fn, const char *name)
+{
+	uint32_t hash = fnv1a_s(FNV1A_INIT, name);
+	struct qopt_temp *temp = fn->buckets[hash % TEMP_BUCKETS];
+	for (; temp; temp = temp->next) {
+		if (strcmp(temp->name, name) == 0) {
+			return temp;
+		}
+	}
+	return NULL;
+}
+
+static struct qopt_temp *
+temp_get(struct qopt_func *fn, const char *name, const struct qbe_type *type)
+{
+	struct qopt_temp *temp = temp_lookup(fn, name);
+	if (temp) {
+		return temp;
+	}
+	uint32_t hash = fnv1a_s(FNV1A_INIT, name);
+	struct qopt_temp **bucket = &fn->buckets[hash % TEMP_BUCKETS];
+	temp = xcalloc(1, sizeof(struct qopt_temp));
+	temp->name = name;
+	temp->class = qclass(type);
+	temp->next = *bucket;
+	*bucket = temp;
+	++fn->ntemps;
+	return temp;
+}
+
+static void
+temps_define(struct qopt_func *fn, struct qbe_statements *stmts)
+{
+	for (size_t i = 0; i < stmts->ln; ++i) {
+		struct qbe_statement *stmt = &stmts->stmts[i];
+		if (stmt->type != Q_INSTR || !stmt->out) {
+			continue;
+		}
+		struct qopt_temp *temp =
+			temp_get(fn, stmt->out->name, stmt->out->type);
+		if (temp->defs++ == 0) {
+			temp->def = stmt;
+		} else {
+			temp->def = NULL;
+		}
+		temp->alloc = temp->defs == 1 && (stmt->instr == Q_ALLOC4
+			|| stmt->instr == Q_ALLOC8 || stmt->instr == Q_ALLOC16);
+	}
+}
+
+static void
+temps_use(struct qopt_func *fn, struct qbe_statements *stmts)
+{
+	for (size_t i = 0; i < stmts->ln; ++i) {
+		struct qbe_statement *stmt = &stmts->stmts[i];
+		if (stmt->type != Q_INSTR) {
+			continue;
+		}
+		for (struct qbe_arguments *arg = stmt->args; arg; arg = arg->next) {
+			if (arg->value.kind != QV_TEMPORARY) {
+				continue;
+			}
+			struct qopt_temp *temp = temp_lookup(fn, arg->value.name);
+			if (temp) {
+				++temp->uses;
+			}
+		}
+	}
+}
+
+static void
+temps_init(struct qopt_func *fn, struct qbe_func *func)
+{
+	for (struct qbe_func_param *param = func->params; param;
+			param = param->next) {
+		struct qopt_temp *temp = temp_get(fn, param->name, param->type);
+		++temp->defs;
+	}
+	temps_define(fn, &func->prelude);
+	temps_define(fn, &func->body);
+	temps_use(fn, &func->prelude);
+	temps_use(fn, &func->body);
+}
+
+static void
+temps_finish(struct qopt_func *fn)
+{
+	for (size_t i = 0; i < TEMP_BUCKETS; ++i) {
+		struct qopt_temp *temp = fn->buckets[i];
+		while (temp) {
+			struct qopt_temp *next = temp->next;
+			free(temp);
+			temp = next;
+		}
+	}
+}
+
+static enum qbe_stype
+value_class(struct qopt_func *fn, const struct qbe_value *val)
+{
+	switch (val->kind) {
+	case QV_CONST:
+		return qclass(val->type);
+	case QV_GLOBAL:
+		return Q_LONG;
+	case QV_TEMPORARY:;
+		const struct qopt_temp *temp = temp_lookup(fn, val->name);
+		return temp ? temp->class : Q__VOID;
+	case QV_LABEL:
+	case QV_VARIADIC:
+		return Q__VOID;
+	}
+	abort(); // Unreachable
+}
+
+static bool
+value_eq(const struct qbe_value *a, const struct qbe_value *b)
+{
+	if (a->kind != b->kind) {
+		return false;
+	}
+	switch (a->kind) {
+	case QV_CONST:
+		if (qclass(a->type) != qclass(b->type)) {
+			return false;
+		}
+		if (a->type->size < sizeof(uint64_t)) {
+			return a->wval == b->wval;
+		}
+		return a->lval == b->lval;
+	case QV_GLOBAL:
+		return a->threadlocal == b->threadlocal
+			&& strcmp(a->name, b->name) == 0;
+	case QV_TEMPORARY:
+		return strcmp(a->name, b->name) == 0;
+	case QV_LABEL:
+	case QV_VARIADIC:
+		return false;
+	}
+	abort(); // Unreachable
+}
+
+static bool
+is_temp(const struct qbe_value *val, const char *name)
+{
+	return val->kind == QV_TEMPORARY && strcmp(val->name, name) == 0;
+}
+
+static bool
+is_const(const struct qbe_value *val, uint64_t n)
+{
+	if (val->kind != QV_CONST) {
+		return false;
+	}
+	switch (qclass(val->type)) {
+	case Q_WORD:
+		return val->wval == n;
+	case Q_LONG:
+		return val->lval == n;
+	default:
+		return false;
+	}
+}
+
+// Whether a temporary of the given class may be replaced by val everywhere
+// it is used
+static bool
+propagable(struct qopt_func *fn, const struct qbe_value *val,
+		enum qbe_stype class)
+{
+	switch (val->kind) {
+	case QV_CONST:
+		return qclass(val->type) == class;
+	case QV_GLOBAL:
+		return !val->threadlocal && class == Q_LONG;
+	case QV_TEMPORARY:;
+		const struct qopt_temp *temp = temp_lookup(fn, val->name);
+		return temp && temp->defs == 1 && temp->class == class;
+	case QV_LABEL:
+	case QV_VARIADIC:
+		return false;
+	}
+	abort(); // Unreachable
+}
+
+// Follows copies of temporaries which are only defined once back to the
+// value they were copied from
+static const struct qbe_value *
+resolve(struct qopt_func *fn, const struct qbe_value *val)
+{
+	for (size_t depth = 0; depth < 16; ++depth) {
+		if (val->kind != QV_TEMPORARY) {
+			break;
+		}
+		const struct qopt_temp *temp = temp_lookup(fn, val->name);
+		if (!temp || temp->defs != 1 || !temp->def
+				|| temp->def->instr != Q_COPY) {
+			break;
+		}
+		const struct qbe_value *src = &temp->def->args->value;
+		if (!propagable(fn, src, temp->class)) {
+			break;
+		}
+		val = src;
+	}
+	return val;
+}
+
+static void
+block_clear(struct qopt_block *blk)
+{
+	blk->ncopies = blk->nmems = 0;
+}
+
+// Forgets everything the block knows about a temporary which is redefined
+static void
+block_kill(struct qopt_block *blk, const char *name)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < blk->ncopies; ++i) {
+		struct qopt_copy *copy = &blk->copies[i];
+		if (strcmp(copy->name, name) != 0
+				&& !is_temp(&copy->value, name)) {
+			blk->copies[n++] = *copy;
+		}
+	}
+	blk->ncopies = n;
+
+	n = 0;
+	for (size_t i = 0; i < blk->nmems; ++i) {
+		struct qopt_mem *mem = &blk->mems[i];
+		if (!is_temp(&mem->addr, name) && !is_temp(&mem->value, name)) {
+			blk->mems[n++] = *mem;
+		}
+	}
+	blk->nmems = n;
+}
+
+// Forgets what the block knows about memory which a store to addr may
+// overwrite. A store to an alloc can only overwrite memory addressed from
+// it, and a NULL addr may overwrite anything.
+static void
+block_clobber(struct qopt_func *fn, struct qopt_block *blk,
+		const struct qbe_value *addr)
+{
+	const struct qopt_temp *alloc = NULL;
+	if (addr && addr->kind == QV_TEMPORARY) {
+		alloc = temp_lookup(fn, addr->name);
+	}
+	if (!alloc || !alloc->alloc) {
+		blk->nmems = 0;
+		return;
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < blk->nmems; ++i) {
+		struct qopt_mem *mem = &blk->mems[i];
+		if (mem->addr.kind != QV_TEMPORARY
+				|| strcmp(mem->addr.name, alloc->name) == 0) {
+			continue;
+		}
+		const struct qopt_temp *other = temp_lookup(fn, mem->addr.name);
+		if (other && other->alloc) {
+			blk->mems[n++] = *mem;
+		}
+	}
+	blk->nmems = n;
+}
+
+static void
+block_copy(struct qopt_block *blk, const char *name,
+		const struct qbe_value *val)
+{
+	if (blk->ncopies == BLOCK_MAX) {
+		memmove(&blk->copies[0], &blk->copies[1],
+			sizeof(blk->copies[0]) * (BLOCK_MAX - 1));
+		--blk->ncopies;
+	}
+	blk->copies[blk->ncopies++] = (struct qopt_copy){
+		.name = name,
+		.value = *val,
+	};
+}
+
+static void
+block_mem(struct qopt_block *blk, const struct qbe_value *addr,
+		const struct qbe_value *val, enum qbe_instr instr,
+		enum qbe_stype class)
+{
+	if (blk->nmems == BLOCK_MAX) {
+		memmove(&blk->mems[0], &blk->mems[1],
+			sizeof(blk->mems[0]) * (BLOCK_MAX - 1));
+		--blk->nmems;
+	}
+	blk->mems[blk->nmems++] = (struct qopt_mem){
+		.addr = *addr,
+		.value = *val,
+		.instr = instr,
+		.class = class,
+	};
+}
+
+// The width of the memory accessed by a load or store, or 0 for other
+// instructions
+static size_t
+mem_width(enum qbe_instr instr, bool *fp, bool *store)
+{
+	*fp = *store = false;
+	switch (instr) {
+	case Q_STOREB:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADSB:
+	case Q_LOADUB:
+		return 1;
+	case Q_STOREH:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADSH:
+	case Q_LOADUH:
+		return 2;
+	case Q_STOREW:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADSW:
+	case Q_LOADUW:
+		return 4;
+	case Q_STOREL:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADL:
+		return 8;
+	case Q_STORES:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADS:
+		*fp = true;
+		return 4;
+	case Q_STORED:
+		*store = true;
+		/* fallthrough */
+	case Q_LOADD:
+		*fp = true;
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+// The class of the value which a load or store of memory in the block moves
+static enum qbe_stype
+mem_class(const struct qopt_mem *mem)
+{
+	bool fp, store;
+	size_t width = mem_width(mem->instr, &fp, &store);
+	if (!store) {
+		return mem->class;
+	} else if (fp) {
+		return width == 8 ? Q_DOUBLE : Q_SINGLE;
+	}
+	return width == 8 ? Q_LONG : Q_WORD;
+}
+
+// The instruction which computes the result of a load of the given class from
+// what the block knows the memory holds, or Q_LAST_INSTR if there is none
+static enum qbe_instr
+forward_load(const struct qopt_mem *mem, enum qbe_instr load,
+		enum qbe_stype class)
+{
+	bool fp, store, mfp, mstore;
+	size_t width = mem_width(load, &fp, &store);
+	size_t mwidth = mem_width(mem->instr, &mfp, &mstore);
+	if (!mstore) {
+		if (mem->instr == load && mem->class == class) {
+			return Q_COPY;
+		}
+		return Q_LAST_INSTR;
+	}
+	if (width != mwidth || fp != mfp) {
+		return Q_LAST_INSTR;
+	}
+	switch (load) {
+	case Q_LOADSB:
+		return Q_EXTSB;
+	case Q_LOADUB:
+		return Q_EXTUB;
+	case Q_LOADSH:
+		return Q_EXTSH;
+	case Q_LOADUH:
+		return Q_EXTUH;
+	case Q_LOADSW:
+		return class == Q_WORD ? Q_COPY : Q_EXTSW;
+	case Q_LOADUW:
+		return class == Q_WORD ? Q_COPY : Q_EXTUW;
+	default:
+		return Q_COPY;
+	}
+}
+
+// Whether the value of an extension is the same as its operand, which was
+// defined by instr
+static bool
+extended(enum qbe_instr ext, enum qbe_instr instr)
+{
+	switch (ext) {
+	case Q_EXTUB:
+		return instr == Q_LOADUB || instr == Q_EXTUB;
+	case Q_EXTUH:
+		return instr == Q_LOADUB || instr == Q_EXTUB
+			|| instr == Q_LOADUH || instr == Q_EXTUH;
+	case Q_EXTSB:
+		return instr == Q_LOADSB || instr == Q_EXTSB;
+	case Q_EXTSH:
+		return instr == Q_LOADSB || instr == Q_EXTSB
+			|| instr == Q_LOADSH || instr == Q_EXTSH;
+	default:
+		return false;
+	}
+}
+
+static void
+to_copy(struct qbe_statement *stmt, struct qbe_arguments *arg)
+{
+	stmt->instr = Q_COPY;
+	stmt->args = arg;
+	arg->next = NULL;
+}
+
+// Removed statements are left as empty comments until the statement list is
+// compacted
+static void
+remove_stmt(struct qbe_statement *stmt)
+{
+	stmt->type = Q_COMMENT;
+	stmt->comment = NULL;
+}
+
+// Replaces arithmetic identities and extensions of values which are already
+// extended with copies
+static void
+simplify(struct qopt_func *fn, struct qbe_statement *stmt)
+{
+	if (!stmt->out || !stmt->args) {
+		return;
+	}
+	enum qbe_stype class = qclass(stmt->out->type);
+	struct qbe_arguments *lhs = stmt->args, *rhs = lhs->next;
+	switch (stmt->instr) {
+	case Q_ADD:
+	case Q_OR:
+	case Q_XOR:
+		if (class != Q_WORD && class != Q_LONG) {
+			break;
+		}
+		if (is_const(&lhs->value, 0)) {
+			to_copy(stmt, rhs);
+			break;
+		}
+		/* fallthrough */
+	case Q_SUB:
+	case Q_SHL:
+	case Q_SHR:
+	case Q_SAR:
+		if ((class == Q_WORD || class == Q_LONG)
+				&& is_const(&rhs->value, 0)) {
+			to_copy(stmt, lhs);
+		}
+		break;
+	case Q_MUL:
+		if (class != Q_WORD && class != Q_LONG) {
+			break;
+		}
+		if (is_const(&lhs->value, 1)) {
+			to_copy(stmt, rhs);
+			break;
+		}
+		/* fallthrough */
+	case Q_DIV:
+	case Q_UDIV:
+		if ((class == Q_WORD || class == Q_LONG)
+				&& is_const(&rhs->value, 1)) {
+			to_copy(stmt, lhs);
+		}
+		break;
+	case Q_EXTUB:
+	case Q_EXTUH:
+	case Q_EXTSB:
+	case Q_EXTSH:
+		if (class != Q_WORD || lhs->value.kind != QV_TEMPORARY) {
+			break;
+		}
+		const struct qopt_temp *temp = temp_lookup(fn, lhs->value.name);
+		if (temp && temp->defs == 1 && temp->def
+				&& temp->class == Q_WORD
+				&& extended(stmt->instr, temp->def->instr)) {
+			to_copy(stmt, lhs);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+substitute(struct qopt_func *fn, struct qopt_block *blk,
+		struct qbe_statement *stmt)
+{
+	for (struct qbe_arguments *arg = stmt->args; arg; arg = arg->next) {
+		if (arg->value.kind != QV_TEMPORARY) {
+			continue;
+		}
+		const struct qbe_value *val = NULL;
+		for (size_t i = blk->ncopies; i > 0; --i) {
+			if (strcmp(blk->copies[i - 1].name, arg->value.name) == 0) {
+				val = &blk->copies[i - 1].value;
+				break;
+			}
+		}
+		if (!val) {
+			val = resolve(fn, &arg->value);
+		}
+		if (val == &arg->value) {
+			continue;
+		}
+
+		if (stmt->instr != Q_CALL) {
+			arg->value = *val;
+		} else if (arg == stmt->args) {
+			// The callee may not be a constant
+			if (val->kind != QV_CONST) {
+				arg->value = *val;
+			}
+		} else if (val->kind != QV_CONST
+				|| qclass(arg->value.type) == qclass(val->type)) {
+			// Arguments keep the type they are passed as
+			const struct qbe_type *type = arg->value.type;
+			arg->value = *val;
+			arg->value.type = type;
+		}
+	}
+}
+
+static void
+forward(struct qopt_func *fn, struct qbe_statements *stmts)
+{
+	struct qopt_block blk = {0};
+	for (size_t i = 0; i < stmts->ln; ++i) {
+		struct qbe_statement *stmt = &stmts->stmts[i];
+		if (stmt->type == Q_LABEL) {
+			block_clear(&blk);
+			continue;
+		}
+		if (stmt->type != Q_INSTR) {
+			continue;
+		}
+
+		substitute(fn, &blk, stmt);
+		simplify(fn, stmt);
+
+		bool fp, store;
+		size_t width = mem_width(stmt->instr, &fp, &store);
+		const struct qbe_value *addr = NULL;
+		bool load = false;
+		if (store) {
+			const struct qbe_value *val = &stmt->args->value;
+			addr = &stmt->args->next->value;
+			for (size_t j = 0; j < blk.nmems; ++j) {
+				const struct qopt_mem *mem = &blk.mems[j];
+				bool mfp, mstore;
+				if (value_eq(&mem->addr, addr)
+						&& value_eq(&mem->value, val)
+						&& mem_width(mem->instr, &mfp, &mstore) == width
+						&& mfp == fp) {
+					// The memory already holds this value
+					remove_stmt(stmt);
+					break;
+				}
+			}
+			if (stmt->type != Q_INSTR) {
+				continue;
+			}
+			block_clobber(fn, &blk, addr);
+			block_mem(&blk, addr, val, stmt->instr, Q__VOID);
+			continue;
+		} else if (width != 0) {
+			addr = &stmt->args->value;
+			enum qbe_stype class = qclass(stmt->out->type);
+			load = true;
+			for (size_t j = blk.nmems; j > 0; --j) {
+				const struct qopt_mem *mem = &blk.mems[j - 1];
+				if (!value_eq(&mem->addr, addr)) {
+					continue;
+				}
+				enum qbe_instr instr =
+					forward_load(mem, stmt->instr, class);
+				if (instr == Q_LAST_INSTR || value_class(fn,
+						&mem->value) != mem_class(mem)) {
+					continue;
+				}
+				stmt->instr = instr;
+				stmt->args->value = mem->value;
+				load = false;
+				break;
+			}
+		}
+
+		switch (stmt->instr) {
+		case Q_BLIT:
+			block_clobber(fn, &blk, &stmt->args->next->value);
+			break;
+		case Q_CALL:
+		case Q_VAARG:
+		case Q_VASTART:
+			block_clobber(fn, &blk, NULL);
+			break;
+		default:
+			break;
+		}
+
+		if (stmt->out) {
+			block_kill(&blk, stmt->out->name);
+		}
+		if (load && !is_temp(addr, stmt->out->name)) {
+			block_mem(&blk, addr, stmt->out, stmt->instr,
+				qclass(stmt->out->type));
+		}
+		if (stmt->instr == Q_COPY) {
+			const struct qbe_value *val = &stmt->args->value;
+			enum qbe_stype class = qclass(stmt->out->type);
+			if (!is_temp(val, stmt->out->name)
+					&& !(val->kind == QV_GLOBAL && val->threadlocal)
+					&& value_class(fn, val) == class) {
+				block_copy(&blk, stmt->out->name, val);
+			}
+		}
+
+		switch (stmt->instr) {
+		case Q_JMP:
+		case Q_JNZ:
+		case Q_RET:
+		case Q_HLT:
+			block_clear(&blk);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// Whether an instruction has no effect but defining its result
+static bool
+pure(enum qbe_instr instr)
+{
+	switch (instr) {
+	case Q_BLIT:
+	case Q_CALL:
+	case Q_DBGLOC:
+	case Q_DIV:
+	case Q_HLT:
+	case Q_JMP:
+	case Q_JNZ:
+	case Q_REM:
+	case Q_RET:
+	case Q_STOREB:
+	case Q_STORED:
+	case Q_STOREH:
+	case Q_STOREL:
+	case Q_STORES:
+	case Q_STOREW:
+	case Q_UDIV:
+	case Q_UREM:
+	case Q_VAARG:
+	case Q_VASTART:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static bool
+eliminate(struct qopt_func *fn, struct qbe_statements *stmts)
+{
+	bool changed = false;
+	for (size_t i = stmts->ln; i > 0; --i) {
+		struct qbe_statement *stmt = &stmts->stmts[i - 1];
+		if (stmt->type != Q_INSTR || !stmt->out || !pure(stmt->instr)) {
+			continue;
+		}
+		const struct qopt_temp *temp = temp_lookup(fn, stmt->out->name);
+		if (temp->uses != 0) {
+			continue;
+		}
+		for (struct qbe_arguments *arg = stmt->args; arg; arg = arg->next) {
+			if (arg->value.kind != QV_TEMPORARY) {
+				continue;
+			}
+			struct qopt_temp *used = temp_lookup(fn, arg->value.name);
+			if (used) {
+				--used->uses;
+			}
+		}
+		remove_stmt(stmt);
+		changed = true;
+	}
+	return changed;
+}
+
+static void
+compact(struct qbe_statements *stmts)
+{
+	size_t n = 0;
+	for (size_t i = 0; i < stmts->ln; ++i) {
+		struct qbe_statement *stmt = &stmts->stmts[i];
+		if (stmt->type == Q_COMMENT && !stmt->comment) {
+			continue;
+		}
+		stmts->stmts[n++] = *stmt;
+	}
+	stmts->ln = n;
+}
+
+static void
+optimize_func(struct qbe_func *func)
+{
+	struct qopt_func fn = {0};
+	temps_init(&fn, func);
+	forward(&fn, &func->body);
+
+	for (size_t i = 0; i < TEMP_BUCKETS; ++i) {
+		for (struct qopt_temp *temp = fn.buckets[i]; temp;
+				temp = temp->next) {
+			temp->uses = 0;
+		}
+	}
+	temps_use(&fn, &func->prelude);
+	temps_use(&fn, &func->body);
+	while (eliminate(&fn, &func->body) | eliminate(&fn, &func->prelude));
+
+	compact(&func->prelude);
+	compact(&func->body);
+	temps_finish(&fn);
+}
+
+void
+qopt(struct qbe_program *prog)
+{
+	for (struct qbe_def *def = prog->defs; def; def = def->next) {
+		if (def->kind == Q_FUNC) {
+			optimize_func(&def->func);
+		}
+	}
+}
+
+static void
+stats_stmts(const struct qbe_statements *stmts, struct qopt_stats *stats)
+{
+	for (size_t i = 0; i < stmts->ln; ++i) {
+		const struct qbe_statement *stmt = &stmts->stmts[i];
+		if (stmt->type != Q_INSTR || stmt->instr == Q_DBGLOC) {
+			continue;
+		}
+		++stats->instrs;
+		bool fp, store;
+		if (stmt->instr == Q_COPY) {
+			++stats->copies;
+		} else if (mem_width(stmt->instr, &fp, &store) != 0) {
+			if (store) {
+				++stats->stores;
+			} else {
+				++stats->loads;
+			}
+		}
+	}
+}
+
+void
+qopt_stats(const struct qbe_program *prog, struct qopt_stats *stats)
+{
+	*stats = (struct qopt_stats){0};
+	for (const struct qbe_def *def = prog->defs; def; def = def->next) {
+		if (def->kind != Q_FUNC) {
+			continue;
+		}
+		// The temporaries are only counted, so the function is not
+		// modified
+		struct qbe_func *func = (struct qbe_func *)&def->func;
+		struct qopt_func fn = {0};
+		temps_init(&fn, func);
+		++stats->funcs;
+		stats->temps += fn.ntemps;
+		stats_stmts(&func->prelude, stats);
+		stats_stmts(&func->body, stats);
+		temps_finish(&fn);
+	}
+}
+
+void
+qopt_print_stats(const struct qopt_stats *stats, const char *when, FILE *out)
+{
+	xfprintf(out, "%s: %zu functions, %zu instructions, %zu temporaries, "
+		"%zu copies, %zu loads, %zu stores\n", when,
+		stats->funcs, stats->instrs, stats->temps,
+		stats->copies, stats->loads, stats->stores);
+}
@@ -143,14 +143,24 @@ emit_literal(const struct expression *expr, FILE *out)
 	case STORAGE_SLICE:
 	case STORAGE_ARRAY:
 		xfprintf(out, "[");
+		bool expand = t->array.expandable;
 		for (const struct array_literal *item = val->array;
 				item; item = item->next) {
-			emit_literal(item->value, out);
-			if (item->next) {
-				xfprintf(out, ", ");
+			size_t n = item->repeat + 1;
+			if (!item->next && item->repeat != 0
+					&& t->storage == STORAGE_ARRAY) {
+				// A trailing run can be written as [x...]
+				expand = true;
+				n = 1;
+			}
+			for (size_t i = 0; i < n; ++i) {
+				emit_literal(item->value, out);
+				if (item->next || i + 1 < n) {
+					xfprintf(out, ", ");
+				}
 			}
 		}
-		if (t->array.expandable) {
+		if (expand) {
 			xfprintf(out, "...");
 		}
 		xfprintf(out, "]");
@@ -0,0 +1,89 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ast.h"
+#include "check.h"
+#include "gen.h"
+#include "lex.h"
+#include "parse.h"
+#include "qbe.h"
+#include "type_store.h"
+#include "types.h"
+#include "util.h"
+
+static const char *input =
+	"fn from_global() int = 1;\n"
+	"let global_ref: *fn() int = &from_global;\n"
+	"fn from_static() int = 2;\n"
+	"fn from_init() int = 3;\n"
+	"@init fn init() void = { from_init(); };\n"
+	"@symbol(\"from_symbol\") fn by_symbol() int;\n"
+	"fn from_symbol() int = 4;\n"
+	"fn from_unused() int = 5;\n"
+	"fn unused() int = from_unused();\n"
+	"let unused_global: *fn() int = &unused;\n"
+	"export fn main() void = {\n"
+	"	static let static_ref: *fn() int = &from_static;\n"
+	"	static assert(true);\n"
+	"	global_ref();\n"
+	"	static_ref();\n"
+	"	by_symbol();\n"
+	"};\n";
+
+static bool
+generated(const struct qbe_program *prog, const char *name)
+{
+	for (const struct qbe_def *def = prog->defs; def; def = def->next) {
+		if (strcmp(def->name, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void
+test(const struct qbe_program *prog, const char *name, bool expected)
+{
+	if (generated(prog, name) != expected) {
+		fprintf(stderr, "Expected %s %sto be generated\n",
+			name, expected ? "" : "not ");
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void) {
+	// The target is irrelevant here, since nothing depends on the sizes of
+	// types
+	builtin_types_init("x86_64");
+
+	nsources = 1;
+	sources = (const char *[2]){"<unknown>", "<input>"};
+
+	FILE *in = fmemopen((char *)input, strlen(input), "r");
+	struct lexer lexer;
+	lex_init(&lexer, in, 1);
+	struct ast_unit aunit = {0};
+	parse(&lexer, &aunit.subunits);
+	lex_finish(&lexer);
+
+	static type_store ts = {0};
+	struct unit unit = {0};
+	check(&ts, false, "main", NULL, &aunit, &unit);
+
+	struct qbe_program prog = {0};
+	gen(&unit, &ts, &prog);
+
+	test(&prog, "main", true);
+	test(&prog, "global_ref", true);
+	test(&prog, "from_global", true);
+	test(&prog, "from_static", true);
+	test(&prog, "from_init", true);
+	test(&prog, "from_symbol", true);
+
+	test(&prog, "unused_global", false);
+	test(&prog, "unused", false);
+	test(&prog, "from_unused", false);
+}